@@ -0,0 +1,389 @@
+/**
+ * ============================================================================
+ * PingPongOS - Projeto B
+ * Disco virtual com o disk.dat mapeado em memória
+ *
+ * Alternativa ao disk-driver.o com a mesma interface (disk-driver.h): o
+ * disk.dat é mapeado com mmap e cada comando copia o bloco de ou para o
+ * mapeamento, sem lseek/read/write. A conclusão é avisada com SIGUSR1,
+ * como no original, depois da latência dada pelo modelo escolhido na
+ * compilação (DISK_LATENCY):
+ *
+ *  - DISK_LATENCY_ZERO: conclui dentro do próprio disk_cmd, para medir
+ *    o gerente de disco sem espera nenhuma pelo disco
+ *  - DISK_LATENCY_FIXED: DISK_FIXED_MS por comando
+ *  - DISK_LATENCY_SEEK: disco mecânico, com trilhas de
+ *    DISK_BLOCKS_PER_TRACK blocos; mover o braço custa DISK_SEEK_SETTLE_US
+ *    mais DISK_SEEK_TRACK_US por trilha, e depois espera o bloco passar
+ *    sob a cabeça (a rotação é contada no relógio, em DISK_ROTATION_US)
+ *
+ * Atende até DISK_MAX_DRIVES discos, cada um com a sua imagem, cabeça e
+ * timer, pelo disk_cmd_dev; o disk_cmd é o disco 0. Todos avisam com o
+ * mesmo SIGUSR1. O disk_cmd_range lê ou escreve um intervalo de blocos
+ * num só comando, com a latência do intervalo inteiro.
+ *
+ * Uso: make DISK_DRIVER=mmap LATENCY=ZERO|FIXED|SEEK
+ * ============================================================================
+ */
+
+#define _XOPEN_SOURCE 600     // sigaction, timer_create, clock_gettime
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "disk-driver.h"
+
+
+/**
+ * ============================================================================
+ * CONFIGURAÇÕES
+ * ============================================================================
+ */
+
+#define DISK_LATENCY_ZERO   0   // conclui na hora
+#define DISK_LATENCY_FIXED  1   // mesmo tempo para todo comando
+#define DISK_LATENCY_SEEK   2   // posicionamento do braço e rotação
+
+#ifndef DISK_LATENCY
+#define DISK_LATENCY DISK_LATENCY_SEEK
+#endif
+
+#ifndef DISK_FIXED_MS
+#define DISK_FIXED_MS 10            // latência do modelo fixo
+#endif
+
+#ifndef DISK_BLOCKS_PER_TRACK
+#define DISK_BLOCKS_PER_TRACK 16    // blocos por trilha
+#endif
+#ifndef DISK_SEEK_SETTLE_US
+#define DISK_SEEK_SETTLE_US 2000    // partida e assentamento do braço
+#endif
+#ifndef DISK_SEEK_TRACK_US
+#define DISK_SEEK_TRACK_US  1000    // por trilha percorrida
+#endif
+#ifndef DISK_ROTATION_US
+#define DISK_ROTATION_US    8333    // uma volta (7200 rpm)
+#endif
+
+#define DISK_NAME       "disk.dat"  // imagem padrão do disco
+#define DISK_BLOCK_SIZE 64          // o mesmo do disk-driver.o
+#define DISK_MAX_DRIVES 16          // discos simulados
+
+// Estado do disco simulado
+typedef struct {
+    int status;                     // DISK_STATUS_*
+    int fd;                         // disk.dat
+    char* image;                    // disk.dat mapeado
+    off_t size;                     // tamanho do mapeamento
+    int numBlocks;
+    int blockSize;
+    int head;                       // bloco sob a cabeça
+    int block;                      // comando em andamento
+    int count;                      // blocos do comando
+    char* buffer;
+    timer_t timer;                  // avisa o fim da latência (SIGRTMIN)
+} mmap_disk_t;
+
+static mmap_disk_t drives[DISK_MAX_DRIVES];    // DISK_STATUS_UNKNOWN é 0
+
+
+/**
+ * ============================================================================
+ * MODELO DE LATÊNCIA
+ * ============================================================================
+ */
+
+#if DISK_LATENCY == DISK_LATENCY_SEEK
+// Relógio monotônico em microssegundos (posição angular do disco)
+static long long nowUs(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+#endif
+
+/**
+ * Tempo para atender um comando nos blocos dados, a partir da cabeça atual
+ *
+ * No modelo mecânico, o braço vai à trilha do primeiro bloco (se não
+ * estiver nela) e o disco gira até o bloco chegar à cabeça; a posição
+ * angular vem do relógio, então o mesmo pedido pode esperar mais ou menos
+ * a rotação. Soma-se a passagem dos blocos (transferência), com a troca
+ * de trilha (DISK_SEEK_TRACK_US) a cada trilha que o intervalo atravessa.
+ * Nos outros modelos a latência é por comando.
+ *
+ * @param drive Disco do comando
+ * @param block Primeiro bloco do comando
+ * @param count Blocos do comando
+ * @return Latência em microssegundos
+ */
+static long long latencyUs(mmap_disk_t* drive, int block, int count) {
+#if DISK_LATENCY == DISK_LATENCY_ZERO
+    return 0;
+#elif DISK_LATENCY == DISK_LATENCY_FIXED
+    return DISK_FIXED_MS * 1000LL;
+#else
+    long long sector = DISK_ROTATION_US / DISK_BLOCKS_PER_TRACK;
+    int from = drive->head / DISK_BLOCKS_PER_TRACK;
+    int to   = block / DISK_BLOCKS_PER_TRACK;
+    long long seek = 0;
+
+    if (from != to) {
+        seek = DISK_SEEK_SETTLE_US + (long long)abs(to - from) * DISK_SEEK_TRACK_US;
+    }
+
+    // Setor sob a cabeça quando o braço chega, e quanto falta para o bloco
+    int under = (int)(((nowUs() + seek) / sector) % DISK_BLOCKS_PER_TRACK);
+    int wait  = (block % DISK_BLOCKS_PER_TRACK - under + DISK_BLOCKS_PER_TRACK)
+                % DISK_BLOCKS_PER_TRACK;
+
+    int crossed = (block + count - 1) / DISK_BLOCKS_PER_TRACK - to;
+
+    return seek + wait * sector + count * sector + (long long)crossed * DISK_SEEK_TRACK_US;
+#endif
+}
+
+// Limites da latência, em ms, para DISK_CMD_DELAYMIN e DISK_CMD_DELAYMAX
+static int latencyBoundMs(mmap_disk_t* drive, int max) {
+#if DISK_LATENCY == DISK_LATENCY_ZERO
+    return 0;
+#elif DISK_LATENCY == DISK_LATENCY_FIXED
+    return DISK_FIXED_MS;
+#else
+    int tracks = (drive->numBlocks + DISK_BLOCKS_PER_TRACK - 1) / DISK_BLOCKS_PER_TRACK;
+
+    if (!max) {
+        return DISK_ROTATION_US / DISK_BLOCKS_PER_TRACK / 1000;
+    }
+    return (DISK_SEEK_SETTLE_US + (tracks - 1) * DISK_SEEK_TRACK_US + DISK_ROTATION_US) / 1000;
+#endif
+}
+
+
+/**
+ * ============================================================================
+ * EXECUÇÃO DOS COMANDOS
+ * ============================================================================
+ */
+
+/**
+ * Conclui o comando em andamento: copia os blocos e avisa com SIGUSR1
+ *
+ * Executada no handler do timer ou, sem latência, dentro do próprio
+ * disk_cmd.
+ *
+ * @param drive Disco do comando
+ */
+static void diskComplete(mmap_disk_t* drive) {
+    char* where = drive->image + (size_t)drive->block * drive->blockSize;
+    size_t size = (size_t)drive->count * drive->blockSize;
+
+    if (drive->status == DISK_STATUS_READ) {
+        memcpy(drive->buffer, where, size);
+    } else {
+        memcpy(where, drive->buffer, size);
+    }
+    drive->head   = drive->block + drive->count - 1;
+    drive->status = DISK_STATUS_IDLE;
+    raise(SIGUSR1);
+}
+
+// Handler dos timers: fim da latência do comando em andamento no disco
+// indicado no sinal (os sinais de tempo real não se perdem se dois discos
+// terminam juntos)
+static void diskTimerHandler(int signum, siginfo_t* info, void* context) {
+    int dev = info->si_value.sival_int;
+
+    if (dev >= 0 && dev < DISK_MAX_DRIVES &&
+        (drives[dev].status == DISK_STATUS_READ || drives[dev].status == DISK_STATUS_WRITE)) {
+        diskComplete(&drives[dev]);
+    }
+}
+
+/**
+ * Desfaz o mapeamento e fecha o arquivo de um disco
+ *
+ * @param drive Disco
+ * @param size Tamanho do mapeamento, em bytes
+ */
+static void diskRelease(mmap_disk_t* drive, off_t size) {
+    munmap(drive->image, size);
+    close(drive->fd);
+    drive->image = NULL;
+    drive->fd    = -1;
+}
+
+/**
+ * Abre e mapeia a imagem de um disco e prepara o timer da latência
+ *
+ * @param dev Número do disco
+ * @param name Arquivo de imagem (NULL para o disk.dat)
+ * @return 0 em sucesso, -1 em erro
+ */
+static int diskInit(int dev, const char* name) {
+    static int handlerInstalled = 0;
+    mmap_disk_t* drive = &drives[dev];
+    struct sigaction action;
+    struct sigevent event;
+    struct stat st;
+
+    if (drive->status != DISK_STATUS_UNKNOWN) {
+        return -1;
+    }
+    if (!name) {
+        name = DISK_NAME;
+    }
+
+    drive->fd = open(name, O_RDWR);
+    if (drive->fd < 0 || fstat(drive->fd, &st) < 0) {
+        fprintf(stderr, "DISK: ");
+        perror(name);
+        if (drive->fd >= 0) {
+            close(drive->fd);
+        }
+        return -1;
+    }
+    drive->blockSize = DISK_BLOCK_SIZE;
+    drive->numBlocks = st.st_size / DISK_BLOCK_SIZE;
+    drive->image = (drive->numBlocks > 0)
+                 ? mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, drive->fd, 0)
+                 : MAP_FAILED;
+    if (drive->image == MAP_FAILED) {
+        perror("DISK: mmap");
+        close(drive->fd);
+        return -1;
+    }
+
+    if (!handlerInstalled) {
+        action.sa_sigaction = diskTimerHandler;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_SIGINFO;
+        if (sigaction(SIGRTMIN, &action, NULL) < 0) {
+            perror("DISK: sigaction");
+            diskRelease(drive, st.st_size);
+            return -1;
+        }
+        handlerInstalled = 1;
+    }
+
+    memset(&event, 0, sizeof(event));
+    event.sigev_notify          = SIGEV_SIGNAL;
+    event.sigev_signo           = SIGRTMIN;
+    event.sigev_value.sival_int = dev;
+    if (timer_create(CLOCK_MONOTONIC, &event, &drive->timer) < 0) {
+        perror("DISK: timer_create");
+        diskRelease(drive, st.st_size);
+        return -1;
+    }
+
+    drive->size   = st.st_size;
+    drive->head   = 0;
+    drive->status = DISK_STATUS_IDLE;
+    return 0;
+}
+
+/**
+ * Fecha um disco livre: remove o timer, desfaz o mapeamento e fecha a
+ * imagem; a entrada volta a aceitar DISK_CMD_INIT
+ *
+ * @param drive Disco
+ * @return 0 em sucesso, -1 se há comando em andamento
+ */
+static int diskClose(mmap_disk_t* drive) {
+    if (drive->status != DISK_STATUS_IDLE) {
+        return -1;
+    }
+
+    timer_delete(drive->timer);
+    diskRelease(drive, drive->size);
+    drive->status = DISK_STATUS_UNKNOWN;
+    return 0;
+}
+
+/**
+ * Agenda a leitura ou escrita de blocos seguidos
+ *
+ * @param drive Disco do comando
+ * @param status DISK_STATUS_READ ou DISK_STATUS_WRITE
+ * @param block Primeiro bloco do comando
+ * @param count Blocos do comando
+ * @param buffer Dados dos blocos
+ * @return 0 se agendado, -1 se o disco está ocupado ou o pedido é inválido
+ */
+static int diskSchedule(mmap_disk_t* drive, int status, int block, int count, void* buffer) {
+    struct itimerspec delay;
+
+    if (drive->status != DISK_STATUS_IDLE || block < 0 || count < 1 ||
+        count > drive->numBlocks - block || !buffer) {
+        return -1;
+    }
+
+    drive->status = status;
+    drive->block  = block;
+    drive->count  = count;
+    drive->buffer = buffer;
+
+    long long us = latencyUs(drive, block, count);
+    if (us == 0) {
+        diskComplete(drive);
+        return 0;
+    }
+
+    memset(&delay, 0, sizeof(delay));
+    delay.it_value.tv_sec  = us / 1000000;
+    delay.it_value.tv_nsec = (us % 1000000) * 1000;
+    if (timer_settime(drive->timer, 0, &delay, NULL) < 0) {
+        drive->status = DISK_STATUS_IDLE;
+        return -1;
+    }
+    return 0;
+}
+
+int disk_cmd_dev(int dev, int cmd, int block, void* buffer) {
+    if (dev < 0 || dev >= DISK_MAX_DRIVES) {
+        return (cmd == DISK_CMD_STATUS) ? DISK_STATUS_UNKNOWN : -1;
+    }
+
+    mmap_disk_t* drive = &drives[dev];
+
+    if (cmd == DISK_CMD_INIT) {
+        return diskInit(dev, buffer);
+    }
+    if (drive->status == DISK_STATUS_UNKNOWN) {
+        return (cmd == DISK_CMD_STATUS) ? DISK_STATUS_UNKNOWN : -1;
+    }
+
+    switch (cmd) {
+        case DISK_CMD_STATUS:    return drive->status;
+        case DISK_CMD_DISKSIZE:  return drive->numBlocks;
+        case DISK_CMD_BLOCKSIZE: return drive->blockSize;
+        case DISK_CMD_DELAYMIN:  return latencyBoundMs(drive, 0);
+        case DISK_CMD_DELAYMAX:  return latencyBoundMs(drive, 1);
+        case DISK_CMD_READ:      return diskSchedule(drive, DISK_STATUS_READ, block, 1, buffer);
+        case DISK_CMD_WRITE:     return diskSchedule(drive, DISK_STATUS_WRITE, block, 1, buffer);
+        case DISK_CMD_CLOSE:     return diskClose(drive);
+    }
+    return -1;
+}
+
+int disk_cmd_range(int dev, int cmd, int block, int count, void* buffer) {
+    if (dev < 0 || dev >= DISK_MAX_DRIVES || drives[dev].status == DISK_STATUS_UNKNOWN) {
+        return -1;
+    }
+
+    switch (cmd) {
+        case DISK_CMD_READ:  return diskSchedule(&drives[dev], DISK_STATUS_READ, block, count, buffer);
+        case DISK_CMD_WRITE: return diskSchedule(&drives[dev], DISK_STATUS_WRITE, block, count, buffer);
+    }
+    return -1;
+}
+
+int disk_cmd(int cmd, int block, void* buffer) {
+    return disk_cmd_dev(0, cmd, block, buffer);
+}
@@ -19,6 +19,7 @@
 #define DISK_CMD_BLOCKSIZE	5	// consulta tamanho de bloco em bytes
 #define DISK_CMD_DELAYMIN	6	// consulta tempo resposta mínimo (ms)
 #define DISK_CMD_DELAYMAX	7	// consulta tempo resposta máximo (ms)
+#define DISK_CMD_CLOSE		8	// fecha o disco (só disk-driver-mmap.c)
 
 // estados internos do disco
 #define DISK_STATUS_UNKNOWN	0	// disco não inicializado
@@ -33,6 +34,20 @@
 
 int disk_cmd (int cmd, int block, void *buffer) ;
 
+// Vários discos (só no disco mapeado em memória, disk-driver-mmap.c): o
+// mesmo comando para o disco dev; disk_cmd é o disco 0. Em DISK_CMD_INIT,
+// buffer é o nome do arquivo de imagem (NULL para o disk.dat). Todos os
+// discos avisam a conclusão com o mesmo SIGUSR1.
+
+int disk_cmd_dev (int dev, int cmd, int block, void *buffer) ;
+
+// Intervalo num só comando (só no disco mapeado em memória): como
+// DISK_CMD_READ/DISK_CMD_WRITE, mas count blocos seguidos a partir de
+// block, com uma só latência (posicionamento e a passagem dos count
+// blocos) e um só SIGUSR1. Retorna 0 se agendado, -1 em erro.
+
+int disk_cmd_range (int dev, int cmd, int block, int count, void *buffer) ;
+
 // Exemplos de uso:
 
 // inicializa um disco (operacao sincrona)
@@ -77,4 +92,10 @@ int disk_cmd (int cmd, int block, void *buffer) ;
 // result < 0: erro
 // result = 0: ok (escrita agendada, sinal SIGUSR1 serah gerado ao completar)
 
+// fecha um disco livre, que volta a não inicializado (operacao sincrona; o
+// disk-driver.o não tem este comando e retorna erro)
+// int disk_cmd_dev (dev, DISK_CMD_CLOSE, 0, 0) ;
+// result < 0: erro (disco ocupado ou não inicializado)
+// result = 0: disco fechado
+
 #endif
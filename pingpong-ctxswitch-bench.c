@@ -0,0 +1,64 @@
+// PingPongOS - PingPong Operating System
+// Benchmark da troca de contexto: custo de um task_switch entre duas tarefas
+
+// A main e uma tarefa trocam o processador diretamente com task_switch,
+// sem passar pelo dispatcher; o tempo medido inclui os hooks de troca.
+// Compilado com swapcontext (padrão) e com a troca rápida
+// (-DPPOS_FAST_SWITCH): make bench-ctxswitch
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "ppos.h"
+#include "ppos-core-globals.h"
+
+#define WARMUP    10000
+#define ROUNDS  1000000
+
+task_t pong ;
+
+// corpo da tarefa: devolve o processador à main a cada ativação
+void Body (void * arg)
+{
+   for (;;)
+      task_switch (taskMain) ;
+}
+
+// relógio monotônico em nanossegundos
+double now_ns ()
+{
+   struct timespec ts ;
+
+   clock_gettime (CLOCK_MONOTONIC, &ts) ;
+   return (ts.tv_sec * 1e9 + ts.tv_nsec) ;
+}
+
+int main (int argc, char *argv[])
+{
+   int i ;
+   double start, elapsed ;
+
+   printf ("main: inicio\n");
+
+   ppos_init () ;
+
+   task_create (&pong, Body, NULL) ;
+
+   for (i = 0; i < WARMUP; i++)
+      task_switch (&pong) ;
+
+   start = now_ns () ;
+   for (i = 0; i < ROUNDS; i++)
+      task_switch (&pong) ;
+   elapsed = now_ns () - start ;
+
+#ifdef PPOS_FAST_SWITCH
+   printf ("%-12s", "rapida") ;
+#else
+   printf ("%-12s", "swapcontext") ;
+#endif
+   printf (" %8d trocas %8.1f ns/troca\n", 2 * ROUNDS, elapsed / (2 * ROUNDS)) ;
+
+   printf ("main: fim\n");
+   exit (0);
+}
@@ -0,0 +1,150 @@
+// PingPongOS - PingPong Operating System
+
+// Teste da conclusão por requisição no gerente de disco: várias tarefas
+// escrevem padrões próprios em blocos espalhados e os releem, com cada
+// política de escalonamento. Fora do FCFS as requisições são atendidas
+// fora de ordem; cada tarefa deve acordar só quando a SUA operação terminou,
+// com o buffer preenchido. Mede também a latência de cada operação.
+// O conteúdo original dos blocos é restaurado ao final de cada rodada.
+// Com -w, o cache grava em write-back (disk_set_cache_write antes do init).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ppos.h"
+#include "ppos-disk-manager.h"
+
+#define NUMTASKS  8       // tarefas concorrentes
+#define BLOCKS    4       // blocos por tarefa
+#define STEP      37      // espalha os blocos das tarefas pelo disco
+
+task_t worker[NUMTASKS] ;
+int numblocks, blocksize ;
+int round_id ;
+
+int errors ;                        // buffers com conteúdo errado
+unsigned int lat_sum, lat_max, ops ;
+
+// bloco k da tarefa i (distintos enquanto NUMTASKS*BLOCKS < numblocks)
+int block_of (int i, int k)
+{
+   return ((k * NUMTASKS + i) * STEP) % numblocks ;
+}
+
+// conteúdo que a tarefa i grava no bloco k nesta rodada
+void fill (char *buffer, int i, int k)
+{
+   int j ;
+
+   for (j = 0; j < blocksize; j++)
+      buffer[j] = 'A' + (i * BLOCKS + k + round_id + j) % 26 ;
+}
+
+// executa uma operação e contabiliza sua latência
+int timed (int write, int block, char *buffer)
+{
+   unsigned int start = systime () ;
+   int result ;
+
+   result = write ? disk_block_write (block, buffer) : disk_block_read (block, buffer) ;
+
+   unsigned int lat = systime () - start ;
+   lat_sum += lat ;
+   if (lat > lat_max)
+      lat_max = lat ;
+   ops++ ;
+
+   return (result) ;
+}
+
+// corpo das tarefas: grava, relê, confere e restaura seus blocos
+void workerBody (void * arg)
+{
+   int i = (long) arg ;
+   int k ;
+   char *saved = malloc (blocksize * BLOCKS) ;
+   char *expected = malloc (blocksize) ;
+   char *buffer = malloc (blocksize) ;
+
+   for (k = 0; k < BLOCKS; k++)
+      if (timed (0, block_of (i, k), saved + k * blocksize) < 0)
+         errors++ ;
+
+   for (k = 0; k < BLOCKS; k++)
+   {
+      fill (expected, i, k) ;
+      if (timed (1, block_of (i, k), expected) < 0)
+         errors++ ;
+   }
+
+   for (k = 0; k < BLOCKS; k++)
+   {
+      fill (expected, i, k) ;
+      memset (buffer, 0, blocksize) ;
+      if (timed (0, block_of (i, k), buffer) < 0 ||
+          memcmp (buffer, expected, blocksize))
+      {
+         printf ("T%02d bloco %3d com conteúdo errado\n", task_id (), block_of (i, k)) ;
+         errors++ ;
+      }
+   }
+
+   for (k = 0; k < BLOCKS; k++)
+      if (timed (1, block_of (i, k), saved + k * blocksize) < 0)
+         errors++ ;
+
+   free (saved) ;
+   free (expected) ;
+   free (buffer) ;
+   task_exit (0) ;
+}
+
+int main (int argc, char *argv[])
+{
+   int policies[] = { SCHEDULER_FCFS, SCHEDULER_SSTF, SCHEDULER_CSCAN,
+                      SCHEDULER_SCAN, SCHEDULER_LOOK, SCHEDULER_CLOOK,
+                      SCHEDULER_DEADLINE, SCHEDULER_FAIR } ;
+   char *names[]  = { "FCFS", "SSTF", "CSCAN", "SCAN", "LOOK", "C-LOOK", "DEADLINE",
+                      "FAIR" } ;
+   int p, i, total = 0 ;
+
+   printf ("main: inicio\n") ;
+
+   ppos_init () ;
+
+   if (argc > 1 && !strcmp (argv[1], "-w"))
+   {
+      disk_set_cache_write (DISK_WRITE_BACK) ;
+      printf ("main: cache em write-back\n") ;
+   }
+
+   if (disk_mgr_init (&numblocks, &blocksize) < 0)
+   {
+      printf ("Erro na abertura do disco\n") ;
+      exit (1) ;
+   }
+
+   for (p = 0; p < sizeof (policies) / sizeof (policies[0]); p++)
+   {
+      disk_set_scheduler (policies[p]) ;
+      round_id = p ;
+      errors = 0 ;
+      lat_sum = lat_max = ops = 0 ;
+
+      for (i = 0; i < NUMTASKS; i++)
+         task_create (&worker[i], workerBody, (void *) (long) i) ;
+      for (i = 0; i < NUMTASKS; i++)
+         task_join (&worker[i]) ;
+      disk_sync () ;    // em write-back, a rodada termina com tudo no disco
+
+      printf ("%-8s: %3u operações, %d erro(s), latência média %4u ms, máxima %4u ms\n",
+              names[p], ops, errors, lat_sum / ops, lat_max) ;
+      total += errors ;
+   }
+
+   printf ("main: %s\n", total ? "FALHOU" : "conteúdo correto com todas as políticas") ;
+   printf ("main: fim\n") ;
+   task_exit (0) ;
+
+   exit (0) ;
+}
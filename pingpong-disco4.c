@@ -0,0 +1,96 @@
+// PingPongOS - PingPong Operating System
+
+// Teste do cache de blocos: tarefas releem sem parar um conjunto quente de
+// blocos enquanto uma varredura percorre o disco inteiro uma única vez. Com
+// LRU a varredura empurra os blocos quentes para fora do cache; com ARC eles
+// ficam na lista dos frequentes. Cada leitura é conferida com uma cópia de
+// referência lida no início. Só lê o disco (não altera disk.dat).
+// O relatório do gerente, ao final, mostra os acertos: make disco4
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ppos.h"
+#include "ppos-disk-manager.h"
+
+#define NUMTASKS  4       // tarefas concorrentes
+#define HOT       32      // blocos do conjunto quente
+#define ROUNDS    96      // leituras quentes por tarefa
+#define SCAN      3       // blocos da varredura a cada leitura quente
+
+task_t worker[NUMTASKS] ;
+int numblocks, blocksize ;
+char *reference ;         // conteúdo de todos os blocos
+
+int errors ;              // leituras com conteúdo diferente da referência
+int reads ;
+
+// lê um bloco e confere com a referência
+void check (int block, char *buffer)
+{
+   reads++ ;
+   if (disk_block_read (block, buffer) < 0 ||
+       memcmp (buffer, reference + block * blocksize, blocksize))
+   {
+      printf ("T%02d bloco %3d com conteúdo errado\n", task_id (), block) ;
+      errors++ ;
+   }
+}
+
+// corpo das tarefas: intercala leituras quentes e a sua parte da varredura
+void workerBody (void * arg)
+{
+   int i = (long) arg ;
+   int k, s, scan = i ;
+   char *buffer = malloc (blocksize) ;
+
+   for (k = 0; k < ROUNDS; k++)
+   {
+      check ((k * 7 + i * 13) % HOT, buffer) ;
+
+      for (s = 0; s < SCAN && scan < numblocks; s++, scan += NUMTASKS)
+         check (scan, buffer) ;
+   }
+
+   free (buffer) ;
+   task_exit (0) ;
+}
+
+int main (int argc, char *argv[])
+{
+   int i ;
+   unsigned int start ;
+
+   printf ("main: inicio\n") ;
+
+   ppos_init () ;
+
+   if (disk_mgr_init (&numblocks, &blocksize) < 0)
+   {
+      printf ("Erro na abertura do disco\n") ;
+      exit (1) ;
+   }
+
+   // cópia de referência, lida bloco a bloco
+   reference = malloc (numblocks * blocksize) ;
+   for (i = 0; i < numblocks; i++)
+      if (disk_block_read (i, reference + i * blocksize) < 0)
+      {
+         printf ("Erro ao ler o bloco %d\n", i) ;
+         exit (1) ;
+      }
+
+   start = systime () ;
+
+   for (i = 0; i < NUMTASKS; i++)
+      task_create (&worker[i], workerBody, (void *) (long) i) ;
+   for (i = 0; i < NUMTASKS; i++)
+      task_join (&worker[i]) ;
+
+   printf ("main: %d leituras em %u ms, %d erro(s)\n", reads, systime () - start, errors) ;
+   printf ("main: %s\n", errors ? "FALHOU" : "conteúdo correto") ;
+   printf ("main: fim\n") ;
+   task_exit (0) ;
+
+   exit (0) ;
+}
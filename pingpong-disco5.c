@@ -0,0 +1,145 @@
+// PingPongOS - PingPong Operating System
+
+// Teste da E/S em intervalos: lê o disco inteiro bloco a bloco e depois
+// com disk_block_readv (intervalos de CHUNK blocos espalhados em dois
+// buffers de tamanhos diferentes), compara os conteúdos e os tempos.
+// Em seguida várias tarefas leem blocos vizinhos ao mesmo tempo, para que
+// o gerente funda as requisições, e o conteúdo original é regravado com
+// disk_block_writev. Por fim, o disco inteiro é lido num só
+// disk_block_readv, maior que DISK_MERGE_MAX blocos (lido em pedaços),
+// com buffers que não acompanham os pedaços. Compilado sem cache, para
+// medir o disco: make disco5
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ppos.h"
+#include "ppos-disk-manager.h"
+
+#define CHUNK     16      // blocos por disk_block_readv/writev
+#define NUMTASKS  8       // tarefas lendo blocos vizinhos
+
+task_t worker[NUMTASKS] ;
+int numblocks, blocksize ;
+char *reference ;         // disco lido bloco a bloco
+int errors ;
+
+// corpo das tarefas: a tarefa i lê os blocos i, i+NUMTASKS, ...
+void workerBody (void * arg)
+{
+   int i = (long) arg ;
+   int b ;
+   char *buffer = malloc (blocksize) ;
+
+   for (b = i; b < numblocks; b += NUMTASKS)
+      if (disk_block_read (b, buffer) < 0 ||
+          memcmp (buffer, reference + b * blocksize, blocksize))
+      {
+         printf ("T%02d bloco %3d com conteúdo errado\n", task_id (), b) ;
+         errors++ ;
+      }
+
+   free (buffer) ;
+   task_exit (0) ;
+}
+
+// lê ou escreve o disco inteiro em intervalos, com dois buffers por intervalo
+int ranges (int write, char *data)
+{
+   struct iovec iov[2] ;
+   int b, count ;
+
+   for (b = 0; b < numblocks; b += count)
+   {
+      count = (numblocks - b < CHUNK) ? numblocks - b : CHUNK ;
+      iov[0].iov_base = data + b * blocksize ;
+      iov[0].iov_len  = blocksize / 2 ;                  // meio bloco
+      iov[1].iov_base = data + b * blocksize + blocksize / 2 ;
+      iov[1].iov_len  = count * blocksize - blocksize / 2 ;
+
+      if ((write ? disk_block_writev (b, count, iov, 2)
+                 : disk_block_readv (b, count, iov, 2)) < 0)
+         return (-1) ;
+   }
+   return (0) ;
+}
+
+int main (int argc, char *argv[])
+{
+   char *data ;
+   unsigned int start ;
+   int i ;
+
+   printf ("main: inicio\n") ;
+
+   ppos_init () ;
+
+   if (disk_mgr_init (&numblocks, &blocksize) < 0)
+   {
+      printf ("Erro na abertura do disco\n") ;
+      exit (1) ;
+   }
+
+   reference = malloc (numblocks * blocksize) ;
+   data = malloc (numblocks * blocksize) ;
+
+   // bloco a bloco
+   start = systime () ;
+   for (i = 0; i < numblocks; i++)
+      if (disk_block_read (i, reference + i * blocksize) < 0)
+         errors++ ;
+   printf ("main: %d blocos lidos um a um em %u ms\n", numblocks, systime () - start) ;
+
+   // em intervalos
+   start = systime () ;
+   if (ranges (0, data) < 0 || memcmp (data, reference, numblocks * blocksize))
+      errors++ ;
+   printf ("main: %d blocos lidos em intervalos de %d em %u ms\n",
+           numblocks, CHUNK, systime () - start) ;
+
+   // tarefas com requisições vizinhas
+   start = systime () ;
+   for (i = 0; i < NUMTASKS; i++)
+      task_create (&worker[i], workerBody, (void *) (long) i) ;
+   for (i = 0; i < NUMTASKS; i++)
+      task_join (&worker[i]) ;
+   printf ("main: %d blocos lidos por %d tarefas em %u ms\n",
+           numblocks, NUMTASKS, systime () - start) ;
+
+   // regrava o conteúdo original em intervalos e confere
+   start = systime () ;
+   if (ranges (1, reference) < 0)
+      errors++ ;
+   printf ("main: %d blocos escritos em intervalos de %d em %u ms\n",
+           numblocks, CHUNK, systime () - start) ;
+   memset (data, 0, numblocks * blocksize) ;
+   if (ranges (0, data) < 0 || memcmp (data, reference, numblocks * blocksize))
+      errors++ ;
+
+   // o disco inteiro de uma vez, em três buffers cortados no meio de blocos
+   struct iovec whole[3] ;
+   memset (data, 0, numblocks * blocksize) ;
+   whole[0].iov_base = data ;
+   whole[0].iov_len  = blocksize * 3 / 2 ;
+   whole[1].iov_base = data + whole[0].iov_len ;
+   whole[1].iov_len  = (DISK_MERGE_MAX + 1) * blocksize - whole[0].iov_len + blocksize / 3 ;
+   whole[2].iov_base = data + whole[0].iov_len + whole[1].iov_len ;
+   whole[2].iov_len  = numblocks * blocksize - whole[0].iov_len - whole[1].iov_len ;
+   if (disk_block_readv (0, numblocks, whole, 3) < 0 ||
+       memcmp (data, reference, numblocks * blocksize))
+      errors++ ;
+   printf ("main: %d blocos lidos num só intervalo\n", numblocks) ;
+
+   // intervalos inválidos
+   struct iovec bad = { data, blocksize } ;
+   if (disk_block_readv (numblocks - 1, 2, &bad, 1) == 0 ||
+       disk_block_readv (0, 2, &bad, 1) == 0)
+      errors++ ;
+
+   printf ("main: %d erro(s)\n", errors) ;
+   printf ("main: %s\n", errors ? "FALHOU" : "conteúdo correto") ;
+   printf ("main: fim\n") ;
+   task_exit (0) ;
+
+   exit (0) ;
+}
@@ -0,0 +1,80 @@
+// PingPongOS - PingPong Operating System
+
+// Teste da divisão do disco entre tarefas: leitoras com prioridades de
+// -20 a +20 leem o mesmo número de blocos espalhados pelo disco, com SSTF
+// e com FAIR. O SSTF ignora quem pediu; com FAIR cada tarefa tem a sua
+// fila e a vez é dividida pelos pesos, então as mais prioritárias terminam
+// antes. Mostra quando cada leitora terminou; a E/S de cada tarefa aparece
+// ao final dela. Só lê o disco. Sem cache e sem leitura antecipada, para
+// medir o disco: make disco6
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ppos.h"
+#include "ppos-disk-manager.h"
+
+#define READERS   4       // leitoras, da prioridade -20 à +20
+#define ROUNDS    24      // leituras por leitora
+
+task_t reader[READERS] ;
+int numblocks, blocksize ;
+unsigned int start, finish[READERS] ;
+int errors ;
+
+// corpo das leitoras: blocos espalhados, diferentes para cada leitora
+void readerBody (void * arg)
+{
+   int i = (long) arg ;
+   int k ;
+   char *buffer = malloc (blocksize) ;
+
+   for (k = 0; k < ROUNDS; k++)
+      if (disk_block_read ((k * 53 + i * 97) % numblocks, buffer) < 0)
+         errors++ ;
+
+   finish[i] = systime () - start ;
+   free (buffer) ;
+   task_exit (0) ;
+}
+
+int main (int argc, char *argv[])
+{
+   int policies[] = { SCHEDULER_SSTF, SCHEDULER_FAIR } ;
+   char *names[]  = { "SSTF", "FAIR" } ;
+   int p, i ;
+
+   printf ("main: inicio\n") ;
+
+   ppos_init () ;
+
+   if (disk_mgr_init (&numblocks, &blocksize) < 0)
+   {
+      printf ("Erro na abertura do disco\n") ;
+      exit (1) ;
+   }
+
+   for (p = 0; p < sizeof (policies) / sizeof (policies[0]); p++)
+   {
+      disk_set_scheduler (policies[p]) ;
+      start = systime () ;
+
+      for (i = 0; i < READERS; i++)
+      {
+         task_create (&reader[i], readerBody, (void *) (long) i) ;
+         task_setprio (&reader[i], -20 + i * 40 / (READERS - 1)) ;
+      }
+      for (i = 0; i < READERS; i++)
+         task_join (&reader[i]) ;
+
+      printf ("%-4s:", names[p]) ;
+      for (i = 0; i < READERS; i++)
+         printf (" prio %+3d em %5u ms%s", task_getprio (&reader[i]), finish[i],
+                 i < READERS - 1 ? "," : "\n") ;
+   }
+
+   printf ("main: %d erro(s)\n", errors) ;
+   printf ("main: fim\n") ;
+   task_exit (0) ;
+
+   exit (0) ;
+}
@@ -0,0 +1,117 @@
+// PingPongOS - PingPong Operating System
+
+// Teste da E/S assíncrona: uma tarefa lê blocos espalhados um a um
+// (disk_block_read) e depois com todos pendentes ao mesmo tempo
+// (disk_submit_read), coletando-os na ordem de conclusão com
+// disk_wait_any, com FCFS, SSTF e CSCAN. Com a fila funda, as políticas
+// que reordenam podem economizar movimento da cabeça. Confere os conteúdos,
+// regrava os blocos com disk_submit_write (sem alterar disk.dat) e espera
+// uma leitura consultando disk_poll. Sem cache, para medir o disco: make disco7
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ppos.h"
+#include "ppos-disk-manager.h"
+
+#define NUMREQS   48      // operações pendentes ao mesmo tempo
+#define STEP      97      // espalha os blocos pelo disco
+
+int numblocks, blocksize ;
+int block[NUMREQS] ;
+char *reference ;         // blocos lidos um a um, na primeira rodada
+char *data ;
+int errors ;
+
+int main (int argc, char *argv[])
+{
+   int policies[] = { SCHEDULER_FCFS, SCHEDULER_SSTF, SCHEDULER_CSCAN } ;
+   char *names[]  = { "FCFS", "SSTF", "CSCAN" } ;
+   diskrequest_t *handle[NUMREQS] ;
+   unsigned int start, sync_time ;
+   int p, i, left ;
+
+   printf ("main: inicio\n") ;
+
+   ppos_init () ;
+
+   if (disk_mgr_init (&numblocks, &blocksize) < 0)
+   {
+      printf ("Erro na abertura do disco\n") ;
+      exit (1) ;
+   }
+
+   reference = malloc (NUMREQS * blocksize) ;
+   data = malloc (NUMREQS * blocksize) ;
+   for (i = 0; i < NUMREQS; i++)
+      block[i] = (i * STEP + 13) % numblocks ;
+
+   for (p = 0; p < sizeof (policies) / sizeof (policies[0]); p++)
+   {
+      disk_set_scheduler (policies[p]) ;
+
+      // um a um: a fila nunca tem mais que uma requisição
+      start = systime () ;
+      for (i = 0; i < NUMREQS; i++)
+         if (disk_block_read (block[i], (p ? data : reference) + i * blocksize) < 0)
+            errors++ ;
+      sync_time = systime () - start ;
+      if (p && memcmp (data, reference, NUMREQS * blocksize))
+         errors++ ;
+
+      // todas pendentes, coletadas na ordem de conclusão
+      memset (data, 0, NUMREQS * blocksize) ;
+      start = systime () ;
+      for (i = 0; i < NUMREQS; i++)
+         if (!(handle[i] = disk_submit_read (block[i], data + i * blocksize)))
+            errors++ ;
+      for (left = NUMREQS; left > 0; left--)
+      {
+         i = disk_wait_any (handle, NUMREQS) ;
+         if (i < 0 || disk_wait (handle[i]) < 0)
+         {
+            errors++ ;
+            break ;
+         }
+         handle[i] = NULL ;
+      }
+      if (memcmp (data, reference, NUMREQS * blocksize))
+         errors++ ;
+
+      printf ("%-5s: %d leituras uma a uma em %5u ms, todas pendentes em %5u ms\n",
+              names[p], NUMREQS, sync_time, systime () - start) ;
+   }
+
+   // regrava o conteúdo lido, com todas as escritas pendentes
+   start = systime () ;
+   for (i = 0; i < NUMREQS; i++)
+      handle[i] = disk_submit_write (block[i], reference + i * blocksize) ;
+   for (i = 0; i < NUMREQS; i++)
+      if (disk_wait (handle[i]) < 0)
+         errors++ ;
+   printf ("main: %d escritas pendentes em %u ms\n", NUMREQS, systime () - start) ;
+
+   // espera por consulta, dormindo entre as consultas
+   diskrequest_t *one = disk_submit_read (block[0], data) ;
+   int polls = 0 ;
+   while (disk_poll (one) == 0)
+   {
+      polls++ ;
+      task_sleep (1) ;
+   }
+   if (disk_wait (one) < 0 || memcmp (data, reference, blocksize))
+      errors++ ;
+   printf ("main: leitura concluída após %d consultas\n", polls) ;
+
+   // descritores inválidos
+   if (disk_submit_read (numblocks, data) || disk_poll (NULL) >= 0 ||
+       disk_wait_any (handle, 0) >= 0)
+      errors++ ;
+
+   printf ("main: %d erro(s)\n", errors) ;
+   printf ("main: %s\n", errors ? "FALHOU" : "conteúdo correto") ;
+   printf ("main: fim\n") ;
+   task_exit (0) ;
+
+   exit (0) ;
+}
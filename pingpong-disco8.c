@@ -0,0 +1,174 @@
+// PingPongOS - PingPong Operating System
+
+// Teste de vários discos e do disco em faixas (RAID-0): cria duas cópias
+// do disk.dat em /tmp, abre cada uma como um disco (disk_dev_init) e junta
+// as duas num disco em faixas de CHUNK blocos (disk_stripe_init). Grava um
+// padrão no disco em faixas com disk_block_writev_dev, lê de volta com
+// disk_block_readv_dev e bloco a bloco, e confere em qual membro cada
+// bloco ficou. Por fim, leituras pendentes nos três discos ao mesmo tempo
+// são coletadas com um só disk_wait_any. Não altera o disk.dat; precisa do
+// disco mapeado em memória: make disco8
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include "ppos.h"
+#include "ppos-disk-manager.h"
+
+#define CHUNK     4       // blocos por faixa
+#define COUNT     40      // blocos gravados no disco em faixas
+#define FIRST     6       // primeiro bloco gravado (no meio de uma faixa)
+#define NUMREQS   12      // leituras pendentes nos três discos
+#define SPARED    64      // blocos dos membros que a gravação pode alterar
+
+int numblocks, blocksize ;
+char image[2][32] ;
+int member[2], stripe ;
+int errors ;
+
+// copia o disk.dat para um arquivo temporário, cujo nome fica em name
+int copyImage (char *name)
+{
+   char buffer[4096] ;
+   FILE *in, *out ;
+   size_t n ;
+   int fd ;
+
+   strcpy (name, "/tmp/ppos-diskXXXXXX") ;
+   if ((fd = mkstemp (name)) < 0)
+      return -1 ;
+   in  = fopen ("disk.dat", "r") ;
+   out = fdopen (fd, "w") ;
+   if (!in || !out)
+      return -1 ;
+   while ((n = fread (buffer, 1, sizeof (buffer), in)) > 0)
+      fwrite (buffer, 1, n, out) ;
+   fclose (in) ;
+   fclose (out) ;
+   return 0 ;
+}
+
+// conteúdo gravado no bloco b do disco em faixas
+void pattern (char *buffer, int b)
+{
+   int i ;
+
+   for (i = 0; i < blocksize; i++)
+      buffer[i] = 'a' + (b + i) % 26 ;
+}
+
+int main (int argc, char *argv[])
+{
+   diskrequest_t *handle[NUMREQS] ;
+   int target[NUMREQS] ;
+   int twice[2] ;
+   struct iovec iov[2] ;
+   char *data, *check, *expect ;
+   int nb, bs, stripeblocks ;
+   int i, b, m, left ;
+
+   printf ("main: inicio\n") ;
+
+   ppos_init () ;
+
+   if (disk_mgr_init (&numblocks, &blocksize) < 0)
+   {
+      printf ("Erro na abertura do disco\n") ;
+      exit (1) ;
+   }
+
+   // dois discos, cópias do disk.dat, e o disco em faixas sobre eles
+   for (i = 0; i < 2; i++)
+      if (copyImage (image[i]) < 0 ||
+          (member[i] = disk_dev_init (image[i], &nb, &bs)) < 0 || nb != numblocks || bs != blocksize)
+      {
+         printf ("Erro na abertura do disco %s\n", image[i]) ;
+         exit (1) ;
+      }
+   stripe = disk_stripe_init (member, 2, CHUNK, &stripeblocks, &bs) ;
+   twice[0] = twice[1] = member[0] ;
+   if (stripe < 0 || stripeblocks != numblocks / CHUNK * CHUNK * 2 || bs != blocksize)
+   {
+      printf ("Erro na criação do disco em faixas\n") ;
+      exit (1) ;
+   }
+   printf ("main: discos %d e %d, em faixas no disco %d com %d blocos\n",
+           member[0], member[1], stripe, stripeblocks) ;
+
+   data   = malloc (COUNT * blocksize) ;
+   check  = malloc (COUNT * blocksize) ;
+   expect = malloc (blocksize) ;
+
+   // grava o padrão em duas partes (dois iovec) e lê de volta de uma vez
+   for (b = 0; b < COUNT; b++)
+      pattern (data + b * blocksize, FIRST + b) ;
+   iov[0].iov_base = data ;
+   iov[0].iov_len  = 7 * blocksize ;
+   iov[1].iov_base = data + 7 * blocksize ;
+   iov[1].iov_len  = (COUNT - 7) * blocksize ;
+   if (disk_block_writev_dev (stripe, FIRST, COUNT, iov, 2) < 0)
+      errors++ ;
+   iov[0].iov_base = check ;
+   iov[0].iov_len  = COUNT * blocksize ;
+   if (disk_block_readv_dev (stripe, FIRST, COUNT, iov, 1) < 0 ||
+       memcmp (data, check, COUNT * blocksize))
+      errors++ ;
+   printf ("main: %d blocos gravados e lidos no disco em faixas\n", COUNT) ;
+
+   // bloco a bloco, no disco em faixas e no membro que guarda cada bloco
+   for (b = FIRST; b < FIRST + COUNT; b++)
+   {
+      m = b / CHUNK % 2 ;
+      pattern (expect, b) ;
+      if (disk_block_read_dev (stripe, b, check) < 0 || memcmp (check, expect, blocksize))
+         errors++ ;
+      if (disk_block_read_dev (member[m], b / CHUNK / 2 * CHUNK + b % CHUNK, check) < 0 ||
+          memcmp (check, expect, blocksize))
+         errors++ ;
+   }
+   printf ("main: blocos conferidos um a um e nos membros\n") ;
+
+   // leituras pendentes no disco 0 e nos dois membros, coletadas juntas;
+   // os blocos ficam além dos gravados, iguais nos três discos
+   for (i = 0; i < NUMREQS; i++)
+   {
+      target[i] = SPARED + (i * 97) % (numblocks - SPARED) ;
+      if (!(handle[i] = disk_submit_read_dev (i % 3 ? member[i % 3 - 1] : 0, target[i],
+                                              data + i * blocksize)))
+         errors++ ;
+   }
+   for (left = NUMREQS; left > 0; left--)
+   {
+      i = disk_wait_any (handle, NUMREQS) ;
+      if (i < 0 || disk_wait (handle[i]) < 0)
+      {
+         errors++ ;
+         break ;
+      }
+      handle[i] = NULL ;
+   }
+   for (i = 0; i < NUMREQS; i++)
+      if (disk_block_read (target[i], check) < 0 || memcmp (check, data + i * blocksize, blocksize))
+         errors++ ;
+   printf ("main: %d leituras pendentes em três discos coletadas\n", NUMREQS) ;
+
+   // discos e faixas inválidos
+   if (disk_dev_init ("/tmp/ppos-nao-existe", &nb, &bs) >= 0 ||
+       disk_stripe_init (member, 0, CHUNK, &nb, &bs) >= 0 ||
+       disk_stripe_init (twice, 2, CHUNK, &nb, &bs) >= 0 ||
+       disk_block_read_dev (stripe, stripeblocks, check) >= 0 ||
+       disk_block_read_dev (DISK_MAX_DEVICES, 0, check) >= 0)
+      errors++ ;
+
+   for (i = 0; i < 2; i++)
+      unlink (image[i]) ;
+
+   printf ("main: %d erro(s)\n", errors) ;
+   printf ("main: %s\n", errors ? "FALHOU" : "conteúdo correto") ;
+   printf ("main: fim\n") ;
+   task_exit (0) ;
+
+   exit (0) ;
+}
@@ -0,0 +1,302 @@
+// PingPongOS - PingPong Operating System
+// Reprodução de um trace do disco (disk_trace_start, ou compilado com
+// DISK_TRACE_FILE) com uma política de escalonamento, para comparar as
+// políticas com um padrão de acesso capturado
+
+// Uso: pingpong-disk-replay trace [-p politica] [-t tarefas] [-f json|csv]
+//                           [-o saida] [-a]
+
+// As operações do trace são feitas num disco novo, uma imagem temporária
+// em /tmp do tamanho do disco do trace (o disk.dat não é tocado), e por
+// isso precisa do disco mapeado em memória. As tarefas do trace são
+// distribuídas em rodízio entre as tarefas da reprodução (padrão: uma por
+// tarefa do trace), e cada uma faz as suas operações na ordem do trace,
+// uma de cada vez, esperando o instante registrado (com -a, sem esperar).
+// Ao fim, mostra vazão, movimentação da cabeça e percentis da latência
+// das operações (da chamada ao retorno) em JSON ou CSV.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include "ppos.h"
+#include "ppos-core-globals.h"
+#include "ppos-disk-manager.h"
+#include "disk-driver.h"
+
+#define MAXTASKS  256     // tarefas distintas no trace e na reprodução
+
+disktrace_header_t header ;
+disktrace_record_t *record ;   // operações do trace, em ordem
+int numrecords ;
+int slot[MAXTASKS] ;           // tarefa da reprodução de cada tarefa do trace
+int traceTask[MAXTASKS] ;      // ids das tarefas do trace, na ordem em que aparecem
+int numTraceTasks ;
+double *latency ;              // latência de cada operação, em us
+task_t player[MAXTASKS] ;
+int disk ;                     // disco da reprodução
+int asap ;                     // -a: sem esperar os instantes do trace
+double start ;
+int errors ;
+
+// relógio monotônico em microssegundos
+double now_us ()
+{
+   struct timespec ts ;
+
+   clock_gettime (CLOCK_MONOTONIC, &ts) ;
+   return (ts.tv_sec * 1e6 + ts.tv_nsec / 1e3) ;
+}
+
+// posição de uma tarefa do trace em traceTask, ou -1
+int traceIndex (int task)
+{
+   int i ;
+
+   for (i = 0; i < numTraceTasks; i++)
+      if (traceTask[i] == task)
+         return i ;
+   return -1 ;
+}
+
+// tarefa da reprodução de uma tarefa do trace (as além de MAXTASKS vão à 0)
+int playerOf (int task)
+{
+   int i = traceIndex (task) ;
+
+   return (i < 0) ? 0 : slot[i] ;
+}
+
+// lê o trace inteiro para a memória; retorna 0 ou -1
+int loadTrace (char *path)
+{
+   FILE *in = fopen (path, "r") ;
+   int size = 1024 ;
+
+   if (!in || fread (&header, sizeof (header), 1, in) != 1 ||
+       header.magic != DISK_TRACE_MAGIC || header.version != DISK_TRACE_VERSION ||
+       header.numBlocks <= 0 || header.blockSize <= 0)
+   {
+      if (in)
+         fclose (in) ;
+      return -1 ;
+   }
+
+   record = malloc (size * sizeof (disktrace_record_t)) ;
+   while (record && fread (&record[numrecords], sizeof (disktrace_record_t), 1, in) == 1)
+      if (++numrecords == size)
+         record = realloc (record, (size *= 2) * sizeof (disktrace_record_t)) ;
+   fclose (in) ;
+   return record ? 0 : -1 ;
+}
+
+// corpo das tarefas da reprodução: as operações das tarefas do trace que lhe cabem
+void playerBody (void * arg)
+{
+   char *buffer = malloc (header.blockSize) ;
+   long me = (long) arg ;
+   double t0 ;
+   int i, status ;
+
+   memset (buffer, 0, header.blockSize) ;
+   for (i = 0; i < numrecords; i++)
+   {
+      if (playerOf (record[i].task) != me)
+         continue ;
+
+      // espera o instante da operação no trace
+      while (!asap && now_us () - start < record[i].time * 1e3)
+         task_yield () ;
+
+      t0 = now_us () ;
+      if (record[i].operation == DISK_CMD_WRITE)
+         status = disk_block_write_dev (disk, record[i].block, buffer) ;
+      else
+         status = disk_block_read_dev (disk, record[i].block, buffer) ;
+      latency[i] = now_us () - t0 ;
+      if (status < 0)
+      {
+         PPOS_PREEMPT_DISABLE ;
+         errors++ ;
+         PPOS_PREEMPT_ENABLE ;
+      }
+   }
+
+   free (buffer) ;
+   task_exit (0) ;
+}
+
+// escreve s como string JSON, com aspas, barras e controles escapados
+void jsonString (FILE *out, char *s)
+{
+   fputc ('"', out) ;
+   for (; *s; s++)
+      if (*s == '"' || *s == '\\')
+         fprintf (out, "\\%c", *s) ;
+      else if ((unsigned char) *s < 0x20)
+         fprintf (out, "\\u%04x", (unsigned char) *s) ;
+      else
+         fputc (*s, out) ;
+   fputc ('"', out) ;
+}
+
+// comparação para qsort
+int compareDouble (const void *a, const void *b)
+{
+   double x = *(const double *) a, y = *(const double *) b ;
+
+   return (x > y) - (x < y) ;
+}
+
+// percentil p das latências ordenadas, pelo posto mais próximo
+double percentile (int p)
+{
+   int rank = (p * numrecords + 99) / 100 ;
+
+   return latency[rank > 0 ? rank - 1 : 0] ;
+}
+
+int main (int argc, char *argv[])
+{
+   char *names[] = { "fcfs", "sstf", "cscan", "scan", "look", "clook", "deadline", "fair" } ;
+   int policies[] = { SCHEDULER_FCFS, SCHEDULER_SSTF, SCHEDULER_CSCAN, SCHEDULER_SCAN,
+                      SCHEDULER_LOOK, SCHEDULER_CLOOK, SCHEDULER_DEADLINE, SCHEDULER_FAIR } ;
+   char *tracePath = NULL, *format = "json", *outPath = NULL, *policyName = "cscan" ;
+   char image[32] = "/tmp/ppos-replayXXXXXX" ;
+   int policy = -1, ntasks = 0 ;
+   int numblocks, blocksize, reads = 0 ;
+   double elapsed, mean = 0 ;
+   diskmetrics_t metrics ;
+   FILE *out = stdout ;
+   int i, fd ;
+
+   for (i = 1; i < argc; i++)
+   {
+      if (!strcmp (argv[i], "-p") && i + 1 < argc)
+         policyName = argv[++i] ;
+      else if (!strcmp (argv[i], "-t") && i + 1 < argc)
+         ntasks = atoi (argv[++i]) ;
+      else if (!strcmp (argv[i], "-f") && i + 1 < argc)
+         format = argv[++i] ;
+      else if (!strcmp (argv[i], "-o") && i + 1 < argc)
+         outPath = argv[++i] ;
+      else if (!strcmp (argv[i], "-a"))
+         asap = 1 ;
+      else if (argv[i][0] != '-' && !tracePath)
+         tracePath = argv[i] ;
+      else
+         tracePath = NULL, i = argc ;
+   }
+   for (i = 0; i < sizeof (policies) / sizeof (policies[0]); i++)
+      if (!strcasecmp (policyName, names[i]))
+         policy = policies[i] ;
+   if (!tracePath || policy < 0 || ntasks < 0 || ntasks > MAXTASKS ||
+       (strcmp (format, "json") && strcmp (format, "csv")))
+   {
+      fprintf (stderr, "Uso: %s trace [-p fcfs|sstf|cscan|scan|look|clook|deadline|fair]"
+               " [-t tarefas] [-f json|csv] [-o saida] [-a]\n", argv[0]) ;
+      exit (1) ;
+   }
+   if (loadTrace (tracePath) < 0)
+   {
+      fprintf (stderr, "Erro na leitura do trace %s\n", tracePath) ;
+      exit (1) ;
+   }
+
+   // tarefas do trace, distribuídas em rodízio entre as da reprodução
+   for (i = 0; i < numrecords; i++)
+      if (traceIndex (record[i].task) < 0 && numTraceTasks < MAXTASKS)
+         traceTask[numTraceTasks++] = record[i].task ;
+   if (ntasks == 0)
+      ntasks = numTraceTasks > 0 ? numTraceTasks : 1 ;
+   for (i = 0; i < numTraceTasks; i++)
+      slot[i] = i % ntasks ;
+   latency = calloc (numrecords + 1, sizeof (double)) ;
+
+   ppos_init () ;
+
+   if (disk_mgr_init (&numblocks, &blocksize) < 0)
+   {
+      printf ("Erro na abertura do disco\n") ;
+      exit (1) ;
+   }
+
+   // disco da reprodução: imagem em branco do tamanho do disco do trace
+   if ((fd = mkstemp (image)) < 0 ||
+       ftruncate (fd, (off_t) header.numBlocks * header.blockSize) < 0 ||
+       close (fd) < 0 ||
+       (disk = disk_dev_init (image, &numblocks, &blocksize)) < 0 ||
+       blocksize != header.blockSize)
+   {
+      fprintf (stderr, "Erro na criação do disco %s (precisa do disco mapeado"
+               " em memória e de blocos de %d bytes)\n", image, header.blockSize) ;
+      unlink (image) ;
+      exit (1) ;
+   }
+   disk_set_scheduler_dev (disk, policy) ;
+
+   start = now_us () ;
+   for (i = 0; i < ntasks; i++)
+      task_create (&player[i], playerBody, (void *) (long) i) ;
+   for (i = 0; i < ntasks; i++)
+      task_join (&player[i]) ;
+   elapsed = now_us () - start ;
+
+   disk_metrics_dev (disk, &metrics) ;
+   unlink (image) ;
+
+   for (i = 0; i < numrecords; i++)
+   {
+      mean += latency[i] / numrecords ;
+      reads += (record[i].operation != DISK_CMD_WRITE) ;
+   }
+   qsort (latency, numrecords, sizeof (double), compareDouble) ;
+
+   if (outPath && !(out = fopen (outPath, "w")))
+   {
+      fprintf (stderr, "Erro na criação de %s\n", outPath) ;
+      exit (1) ;
+   }
+   if (!strcmp (format, "csv"))
+   {
+      fprintf (out, "policy,tasks,operations,reads,writes,errors,elapsed_ms,ops_per_s,"
+               "head_movement,disk_operations,merged,lat_mean_us,lat_p50_us,lat_p90_us,"
+               "lat_p99_us,lat_max_us\n") ;
+      fprintf (out, "%s,%d,%d,%d,%d,%d,%.1f,%.1f,%d,%d,%d,%.0f,%.0f,%.0f,%.0f,%.0f\n",
+               policyName, ntasks, numrecords, reads, numrecords - reads, errors,
+               elapsed / 1e3, numrecords / (elapsed / 1e6), metrics.headMovement,
+               metrics.operations, metrics.merged, mean, percentile (50), percentile (90),
+               percentile (99), latency[numrecords > 0 ? numrecords - 1 : 0]) ;
+   }
+   else
+   {
+      fprintf (out, "{\n") ;
+      fprintf (out, "  \"trace\": ") ;
+      jsonString (out, tracePath) ;
+      fprintf (out, ",\n") ;
+      fprintf (out, "  \"policy\": \"%s\",\n", policyName) ;
+      fprintf (out, "  \"tasks\": %d,\n", ntasks) ;
+      fprintf (out, "  \"timed\": %s,\n", asap ? "false" : "true") ;
+      fprintf (out, "  \"operations\": %d,\n", numrecords) ;
+      fprintf (out, "  \"reads\": %d,\n", reads) ;
+      fprintf (out, "  \"writes\": %d,\n", numrecords - reads) ;
+      fprintf (out, "  \"errors\": %d,\n", errors) ;
+      fprintf (out, "  \"elapsed_ms\": %.1f,\n", elapsed / 1e3) ;
+      fprintf (out, "  \"ops_per_s\": %.1f,\n", numrecords / (elapsed / 1e6)) ;
+      fprintf (out, "  \"head_movement\": %d,\n", metrics.headMovement) ;
+      fprintf (out, "  \"disk_operations\": %d,\n", metrics.operations) ;
+      fprintf (out, "  \"merged\": %d,\n", metrics.merged) ;
+      fprintf (out, "  \"latency_us\": { \"mean\": %.0f, \"p50\": %.0f, \"p90\": %.0f,"
+               " \"p99\": %.0f, \"max\": %.0f }\n", mean, percentile (50), percentile (90),
+               percentile (99), latency[numrecords > 0 ? numrecords - 1 : 0]) ;
+      fprintf (out, "}\n") ;
+   }
+   if (out != stdout)
+      fclose (out) ;
+
+   task_exit (0) ;
+
+   exit (0) ;
+}
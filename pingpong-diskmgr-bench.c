@@ -0,0 +1,113 @@
+// PingPongOS - PingPong Operating System
+// Benchmark da vazão do gerente de disco: leituras por segundo com cada
+// política, com o disco mapeado em memória sem latência (disk-driver-mmap.c
+// com DISK_LATENCY_ZERO), então o tempo medido é só o do gerente: fila,
+// escalonador, conclusão e trocas de contexto
+
+// TASKS tarefas leem blocos espalhados com DEPTH pendentes cada
+// (disk_submit_read, coletadas com disk_wait_any). Sem cache e sem leitura
+// antecipada, toda leitura passa pelo gerente. Só lê o disco.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "ppos.h"
+#include "ppos-disk-manager.h"
+
+#define OPS       40000   // leituras por política
+#define DEPTH     16      // pendentes por tarefa
+#define TASKS     4
+
+task_t reader[TASKS] ;
+int numblocks, blocksize ;
+int errors ;
+
+// relógio monotônico em nanossegundos
+double now_ns ()
+{
+   struct timespec ts ;
+
+   clock_gettime (CLOCK_MONOTONIC, &ts) ;
+   return (ts.tv_sec * 1e9 + ts.tv_nsec) ;
+}
+
+// corpo das leitoras: mantém DEPTH leituras pendentes até ler a sua parte
+void readerBody (void * arg)
+{
+   diskrequest_t *handle[DEPTH] = { NULL } ;
+   char *buffer = malloc (DEPTH * blocksize) ;
+   int next = (long) arg * 7919 ;
+   int left = OPS / TASKS ;
+   int pending = 0 ;
+   int i ;
+
+   while (left > 0 || pending > 0)
+   {
+      // completa as vagas livres com novas leituras
+      for (i = 0; i < DEPTH && left > 0; i++)
+         if (!handle[i])
+         {
+            next = (next * 97 + 13) % numblocks ;
+            if (!(handle[i] = disk_submit_read (next, buffer + i * blocksize)))
+               errors++ ;
+            else
+               pending++ ;
+            left-- ;
+         }
+
+      // coleta uma concluída
+      i = disk_wait_any (handle, DEPTH) ;
+      if (i < 0 || disk_wait (handle[i]) < 0)
+      {
+         errors++ ;
+         break ;
+      }
+      handle[i] = NULL ;
+      pending-- ;
+   }
+
+   free (buffer) ;
+   task_exit (0) ;
+}
+
+int main (int argc, char *argv[])
+{
+   int policies[] = { SCHEDULER_FCFS, SCHEDULER_SSTF, SCHEDULER_CSCAN, SCHEDULER_SCAN,
+                      SCHEDULER_LOOK, SCHEDULER_CLOOK, SCHEDULER_DEADLINE, SCHEDULER_FAIR } ;
+   char *names[] = { "FCFS", "SSTF", "CSCAN", "SCAN", "LOOK", "C-LOOK", "DEADLINE", "FAIR" } ;
+   double start, elapsed ;
+   int p, i ;
+
+   printf ("main: inicio\n") ;
+
+   ppos_init () ;
+
+   if (disk_mgr_init (&numblocks, &blocksize) < 0)
+   {
+      printf ("Erro na abertura do disco\n") ;
+      exit (1) ;
+   }
+
+   printf ("%8s %10s %12s %12s\n", "politica", "leituras", "leituras/s", "us/leitura") ;
+
+   for (p = 0; p < sizeof (policies) / sizeof (policies[0]); p++)
+   {
+      disk_set_scheduler (policies[p]) ;
+
+      start = now_ns () ;
+      for (i = 0; i < TASKS; i++)
+         task_create (&reader[i], readerBody, (void *) (long) i) ;
+      for (i = 0; i < TASKS; i++)
+         task_join (&reader[i]) ;
+      elapsed = now_ns () - start ;
+
+      printf ("%8s %10d %12.0f %12.2f\n", names[p], OPS, OPS / (elapsed / 1e9),
+              elapsed / 1e3 / OPS) ;
+   }
+
+   printf ("main: %d erro(s)\n", errors) ;
+   printf ("main: fim\n") ;
+   task_exit (0) ;
+
+   exit (0) ;
+}
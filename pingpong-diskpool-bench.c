@@ -0,0 +1,106 @@
+// PingPongOS - PingPong Operating System
+// Benchmark do caminho de uma requisição de disco: custo de pedir e
+// concluir uma leitura (criação da requisição, fila, escalonador, gerente,
+// conclusão e despertar da dona), sem a latência do disco
+
+// O disk-driver.o é trocado pelo disco mapeado em memória sem latência
+// (disk-driver-mmap.c com DISK_LATENCY_ZERO), que conclui cada comando na
+// hora. Sem cache e sem leitura antecipada, toda leitura passa pelo
+// gerente; só lê o disco. Mede leituras uma a uma, leituras assíncronas
+// com DEPTH pendentes e TASKS tarefas com DEPTH pendentes cada, mais que
+// as DISK_REQUEST_POOL vagas do pool (as tarefas esperam vaga).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "ppos.h"
+#include "ppos-disk-manager.h"
+
+#define OPS       20000   // leituras por medida
+#define DEPTH     32      // pendentes por tarefa nas leituras assíncronas
+#define TASKS     4
+
+task_t reader[TASKS] ;
+int numblocks, blocksize ;
+int errors ;
+
+// relógio monotônico em nanossegundos
+double now_ns ()
+{
+   struct timespec ts ;
+
+   clock_gettime (CLOCK_MONOTONIC, &ts) ;
+   return (ts.tv_sec * 1e9 + ts.tv_nsec) ;
+}
+
+// lê count blocos espalhados com até DEPTH pendentes, coletando na ordem
+void readAsync (int first, int count)
+{
+   diskrequest_t *handle[DEPTH] ;
+   char *buffer = malloc (DEPTH * blocksize) ;
+   int i, j, n ;
+
+   for (i = 0; i < count; i += n)
+   {
+      n = (count - i < DEPTH) ? count - i : DEPTH ;
+      for (j = 0; j < n; j++)
+         if (!(handle[j] = disk_submit_read (((first + i + j) * 97) % numblocks,
+                                                buffer + j * blocksize)))
+            errors++ ;
+      for (j = 0; j < n; j++)
+         if (handle[j] && disk_wait (handle[j]) < 0)
+            errors++ ;
+   }
+   free (buffer) ;
+}
+
+// corpo das leitoras concorrentes
+void readerBody (void * arg)
+{
+   readAsync ((long) arg * OPS, OPS / TASKS) ;
+   task_exit (0) ;
+}
+
+int main (int argc, char *argv[])
+{
+   char *buffer ;
+   double start ;
+   int i ;
+
+   printf ("main: inicio\n") ;
+
+   ppos_init () ;
+
+   if (disk_mgr_init (&numblocks, &blocksize) < 0)
+   {
+      printf ("Erro na abertura do disco\n") ;
+      exit (1) ;
+   }
+   disk_set_scheduler (SCHEDULER_FCFS) ;
+   buffer = malloc (blocksize) ;
+
+   printf ("%-26s %10s %12s\n", "caso", "leituras", "ns/leitura") ;
+
+   start = now_ns () ;
+   for (i = 0; i < OPS; i++)
+      if (disk_block_read ((i * 97) % numblocks, buffer) < 0)
+         errors++ ;
+   printf ("%-26s %10d %12.1f\n", "uma a uma", OPS, (now_ns () - start) / OPS) ;
+
+   start = now_ns () ;
+   readAsync (0, OPS) ;
+   printf ("%-26s %10d %12.1f\n", "assincronas, 32 pendentes", OPS, (now_ns () - start) / OPS) ;
+
+   start = now_ns () ;
+   for (i = 0; i < TASKS; i++)
+      task_create (&reader[i], readerBody, (void *) (long) i) ;
+   for (i = 0; i < TASKS; i++)
+      task_join (&reader[i]) ;
+   printf ("%-26s %10d %12.1f\n", "4 tarefas, 32 pendentes", OPS, (now_ns () - start) / OPS) ;
+
+   printf ("main: %d erro(s)\n", errors) ;
+   printf ("main: fim\n") ;
+   task_exit (0) ;
+
+   exit (0) ;
+}
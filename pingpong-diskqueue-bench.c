@@ -0,0 +1,101 @@
+// PingPongOS - PingPong Operating System
+// Benchmark da fila do disco: custo de uma decisão do escalonador de
+// requisições (FCFS, SSTF, CSCAN, DEADLINE, FAIR) em função do número de
+// requisições pendentes (1.000 a 100.000)
+
+// Cada decisão é um ciclo disk_scheduler() + disk_dequeue() + disk_enqueue()
+// feito pela main com a preempção desabilitada: o gerente de disco nunca
+// executa, então a cabeça não se move e as requisições nunca vão ao disco.
+// A escolhida volta à fila com outro bloco aleatório, mantendo a fila cheia.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "ppos.h"
+#include "ppos-core-globals.h"
+#include "ppos-disk-manager.h"
+#include "disk-driver.h"
+
+#define MAXREQS   100000
+#define DECISIONS 20000
+
+diskrequest_t *request ;
+int numblocks, blocksize ;
+
+// relógio monotônico em nanossegundos
+double now_ns ()
+{
+   struct timespec ts ;
+
+   clock_gettime (CLOCK_MONOTONIC, &ts) ;
+   return (ts.tv_sec * 1e9 + ts.tv_nsec) ;
+}
+
+int main (int argc, char *argv[])
+{
+   int sizes[] = { 1000, 10000, 100000 } ;
+   int policies[] = { SCHEDULER_FCFS, SCHEDULER_SSTF, SCHEDULER_CSCAN, SCHEDULER_DEADLINE,
+                      SCHEDULER_FAIR } ;
+   char *names[] = { "FCFS", "SSTF", "CSCAN", "DEADLINE", "FAIR" } ;
+   int queued = 0 ;
+   int i, p, d ;
+   double start, elapsed ;
+   diskrequest_t *next ;
+
+   printf ("main: inicio\n");
+
+   ppos_init () ;
+
+   if (disk_mgr_init (&numblocks, &blocksize) < 0)
+   {
+      printf ("Erro na abertura do disco\n") ;
+      exit (1) ;
+   }
+
+   // o gerente não pode rodar: ele atenderia as requisições da fila
+   PPOS_PREEMPT_DISABLE ;
+
+   request = calloc (MAXREQS, sizeof (diskrequest_t)) ;
+   srandom (42) ;
+
+   printf ("%10s %8s %10s %12s\n", "pendentes", "politica", "decisoes", "ns/decisao") ;
+
+   for (i = 0; i < sizeof (sizes) / sizeof (sizes[0]); i++)
+   {
+      // completa a fila com leituras de blocos aleatórios
+      while (queued < sizes[i])
+      {
+         request[queued].operation = DISK_CMD_READ ;
+         request[queued].block = random () % numblocks ;
+         request[queued].count = 1 ;
+         disk_enqueue (&request[queued]) ;
+         queued++ ;
+      }
+
+      for (p = 0; p < sizeof (policies) / sizeof (policies[0]); p++)
+      {
+         disk_set_scheduler (policies[p]) ;
+
+         start = now_ns () ;
+         for (d = 0; d < DECISIONS; d++)
+         {
+            next = disk_scheduler () ;
+            disk_dequeue (next) ;
+            next->block = random () % numblocks ;
+            disk_enqueue (next) ;
+         }
+         elapsed = now_ns () - start ;
+
+         printf ("%10d %8s %10d %12.1f\n", queued, names[p], DECISIONS, elapsed / DECISIONS) ;
+      }
+   }
+
+   // esvazia a fila antes de sair
+   for (i = 0; i < queued; i++)
+      disk_dequeue (&request[i]) ;
+
+   PPOS_PREEMPT_ENABLE ;
+
+   printf ("main: fim\n");
+   exit (0);
+}
@@ -0,0 +1,185 @@
+// PingPongOS - PingPong Operating System
+// Benchmark do disco em faixas (RAID-0): vazão com 1 a 4 discos membros,
+// no disco mapeado em memória com latência de disco mecânico
+// (disk-driver-mmap.c com DISK_LATENCY_SEEK)
+
+// Cada membro é uma cópia do disk.dat em /tmp, com gerente próprio. Mede
+// leituras aleatórias com DEPTH pendentes (disk_submit_read_dev, coletadas
+// com disk_wait_any) e a leitura sequencial do disco em faixas com
+// disk_block_readv_dev de SPAN blocos, e confere cada bloco lido com o do
+// disk.dat que o membro guarda. Sem cache e sem leitura antecipada, toda
+// leitura vai ao disco. Só lê; o disk.dat não muda.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include "ppos.h"
+#include "ppos-disk-manager.h"
+
+#define MEMBERS   4       // máximo de discos membros
+#define CHUNK     8       // blocos por faixa
+#define OPS       256     // leituras aleatórias por medida
+#define DEPTH     32      // leituras aleatórias pendentes
+#define SPAN      32      // blocos por disk_block_readv_dev
+
+int numblocks, blocksize ;
+char image[MEMBERS][32] ;
+int member[MEMBERS] ;
+char *original ;          // conteúdo do disk.dat
+int errors ;
+
+// relógio monotônico em segundos
+double now_s ()
+{
+   struct timespec ts ;
+
+   clock_gettime (CLOCK_MONOTONIC, &ts) ;
+   return (ts.tv_sec + ts.tv_nsec / 1e9) ;
+}
+
+// copia o disk.dat para um arquivo temporário, cujo nome fica em name
+int copyImage (char *name)
+{
+   int fd ;
+
+   strcpy (name, "/tmp/ppos-diskXXXXXX") ;
+   if ((fd = mkstemp (name)) < 0)
+      return -1 ;
+   if (write (fd, original, numblocks * blocksize) != numblocks * blocksize)
+      return -1 ;
+   close (fd) ;
+   return 0 ;
+}
+
+// confere um bloco lido do disco em faixas com n membros
+void verify (int n, int block, char *buffer)
+{
+   int stripe = block / CHUNK ;
+   int where = stripe / n * CHUNK + block % CHUNK ;
+
+   if (memcmp (buffer, original + where * blocksize, blocksize))
+      errors++ ;
+}
+
+// leituras aleatórias com até DEPTH pendentes; retorna o tempo gasto
+double readRandom (int dev, int n, int size)
+{
+   diskrequest_t *handle[DEPTH] = { NULL } ;
+   int block[DEPTH] ;
+   char *buffer = malloc (DEPTH * blocksize) ;
+   int next = 17, left = OPS, pending = 0 ;
+   double start = now_s () ;
+   int i ;
+
+   while (left > 0 || pending > 0)
+   {
+      for (i = 0; i < DEPTH && left > 0; i++)
+         if (!handle[i])
+         {
+            next = (next * 97 + 13) % size ;
+            block[i] = next ;
+            if (!(handle[i] = disk_submit_read_dev (dev, next, buffer + i * blocksize)))
+               errors++ ;
+            else
+               pending++ ;
+            left-- ;
+         }
+
+      i = disk_wait_any (handle, DEPTH) ;
+      if (i < 0 || disk_wait (handle[i]) < 0)
+      {
+         errors++ ;
+         break ;
+      }
+      verify (n, block[i], buffer + i * blocksize) ;
+      handle[i] = NULL ;
+      pending-- ;
+   }
+
+   free (buffer) ;
+   return now_s () - start ;
+}
+
+// lê os primeiros count blocos em sequência, SPAN de cada vez
+double readSequential (int dev, int n, int count)
+{
+   char *buffer = malloc (SPAN * blocksize) ;
+   struct iovec iov = { buffer, SPAN * blocksize } ;
+   double start = now_s () ;
+   int b, i ;
+
+   for (b = 0; b < count; b += SPAN)
+   {
+      if (disk_block_readv_dev (dev, b, SPAN, &iov, 1) < 0)
+         errors++ ;
+      for (i = 0; i < SPAN; i++)
+         verify (n, b + i, buffer + i * blocksize) ;
+   }
+
+   free (buffer) ;
+   return now_s () - start ;
+}
+
+int main (int argc, char *argv[])
+{
+   double elapsed ;
+   int nb, bs, size, stripe ;
+   int n, i ;
+   FILE *in ;
+
+   printf ("main: inicio\n") ;
+
+   ppos_init () ;
+
+   if (disk_mgr_init (&numblocks, &blocksize) < 0)
+   {
+      printf ("Erro na abertura do disco\n") ;
+      exit (1) ;
+   }
+
+   original = malloc (numblocks * blocksize) ;
+   in = fopen ("disk.dat", "r") ;
+   if (!in || fread (original, blocksize, numblocks, in) != numblocks)
+   {
+      printf ("Erro na leitura do disk.dat\n") ;
+      exit (1) ;
+   }
+   fclose (in) ;
+
+   for (i = 0; i < MEMBERS; i++)
+      if (copyImage (image[i]) < 0 || (member[i] = disk_dev_init (image[i], &nb, &bs)) < 0)
+      {
+         printf ("Erro na abertura do disco %s\n", image[i]) ;
+         exit (1) ;
+      }
+
+   printf ("%8s %12s %12s %14s\n", "membros", "leituras/s", "ms/leitura", "seq. blocos/s") ;
+
+   for (n = 1; n <= MEMBERS; n++)
+   {
+      if ((stripe = disk_stripe_init (member, n, CHUNK, &size, &bs)) < 0)
+      {
+         printf ("Erro na criação do disco em faixas\n") ;
+         exit (1) ;
+      }
+      disk_set_scheduler_dev (stripe, SCHEDULER_CLOOK) ;
+
+      elapsed = readRandom (stripe, n, size) ;
+      printf ("%8d %12.1f %12.2f", n, OPS / elapsed, elapsed * 1e3 / OPS) ;
+
+      elapsed = readSequential (stripe, n, numblocks) ;
+      printf (" %14.1f\n", numblocks / elapsed) ;
+   }
+
+   for (i = 0; i < MEMBERS; i++)
+      unlink (image[i]) ;
+
+   printf ("main: %d erro(s)\n", errors) ;
+   printf ("main: fim\n") ;
+   task_exit (0) ;
+
+   exit (0) ;
+}
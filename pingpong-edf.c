@@ -0,0 +1,103 @@
+// PingPongOS - PingPong Operating System
+
+// Teste do escalonador EDF - tarefas periódicas com orçamento, controle de
+// admissão e uma tarefa de fundo sem prazo disputando o processador
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ppos.h"
+
+#define JOBS      6       // jobs executados por tarefa periódica
+#define NUMTASKS  3
+
+task_t task[NUMTASKS], Extra, Fundo ;
+char *name[NUMTASKS] = { "    Pang", "        Peng", "            Ping" } ;
+
+// período e orçamento declarados, e processamento de fato feito por job (ms)
+int period[NUMTASKS] = { 1000, 2000, 1000 } ;
+int budget[NUMTASKS] = {  200,  500,  100 } ;
+int work[NUMTASKS]   = {  150,  400,  250 } ;   // Ping excede o orçamento
+
+volatile int done = 0 ;
+
+// ocupa o processador por ms milissegundos de execução da tarefa atual
+void burn (task_t *self, int ms)
+{
+   unsigned int start = self->running_time ;
+
+   while (self->running_time - start < ms) ;
+}
+
+// corpo das tarefas periódicas: um job por período, dormindo entre jobs
+void Body (void * arg)
+{
+   int i = (long) arg ;
+   int job ;
+
+   for (job = 0; job < JOBS; job++)
+   {
+      printf ("%5d ms: %s job %d (prazo %u)\n", systime(), name[i], job,
+              task[i].deadline) ;
+      burn (&task[i], work[i]) ;
+      task_sleep (period[i] / 1000) ;
+   }
+   done++ ;
+   task_exit (0) ;
+}
+
+// tarefa que não chega a ser admitida
+void Nothing (void * arg)
+{
+   task_exit (0) ;
+}
+
+// tarefa de fundo, sem prazo: só usa o processador ocioso
+void Background (void * arg)
+{
+   while (done < NUMTASKS)
+      burn (&Fundo, 1) ;
+   printf ("%5d ms: fundo executou %u ms\n", systime(), Fundo.running_time) ;
+   task_exit (0) ;
+}
+
+int main (int argc, char *argv[])
+{
+   int i, misses = 0 ;
+
+   printf ("main: inicio\n");
+
+   ppos_init () ;
+   ppos_set_scheduler (CPU_SCHED_EDF) ;
+
+   for (i=0; i<NUMTASKS; i++)
+   {
+      task_create (&task[i], Body, (void *) (long) i) ;
+      if (task_set_period (&task[i], period[i], budget[i]) < 0)
+         printf ("main: %s nao admitida\n", name[i]) ;
+   }
+
+   // utilização total passaria de 1: deve ser recusada
+   task_create (&Extra, Nothing, NULL) ;
+   if (task_set_period (&Extra, 1000, 500) < 0)
+      printf ("main: tarefa extra (1000 ms, 500 ms) recusada pela admissao\n") ;
+   else
+      printf ("main: ERRO: tarefa extra admitida\n") ;
+
+   task_create (&Fundo, Background, NULL) ;
+
+   for (i=0; i<NUMTASKS; i++)
+      task_join (&task[i]) ;
+   task_join (&Extra) ;
+   task_join (&Fundo) ;
+
+   for (i=0; i<NUMTASKS; i++)
+   {
+      printf ("%s: periodo %4d ms, orcamento %3d ms, %u prazo(s) perdido(s), %u job(s) alem do orcamento\n",
+              name[i], period[i], budget[i], task[i].deadline_misses, task[i].budget_overruns) ;
+      misses += task[i].deadline_misses ;
+   }
+   printf ("main: %d prazo(s) perdido(s)\n", misses) ;
+
+   printf ("main: fim\n");
+   exit (misses ? 1 : 0);
+}
@@ -0,0 +1,88 @@
+// PingPongOS - PingPong Operating System
+
+// Teste de carga mista: tarefas CPU-bound disputam o processador com
+// tarefas que fazem leituras de disco; mede a latência de cada leitura
+// (da chamada até a tarefa voltar a executar). Compilado com cada classe
+// de escalonamento (make cpu-sched-<classe>) para comparação.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ppos.h"
+#include "ppos-disk-manager.h"
+
+#define NUMHOGS   4       // tarefas CPU-bound
+#define NUMIO     2       // tarefas de E/S
+#define READS     40      // leituras por tarefa de E/S
+
+task_t hog[NUMHOGS], io[NUMIO] ;
+int numblocks, blocksize ;
+volatile int io_done = 0 ;
+
+unsigned int lat_sum[NUMIO], lat_max[NUMIO] ;
+
+// corpo das tarefas CPU-bound: ocupam o processador até a E/S terminar
+void hogBody (void * arg)
+{
+   while (io_done < NUMIO) ;
+   task_exit (0) ;
+}
+
+// corpo das tarefas de E/S: leituras espalhadas pelo disco
+void ioBody (void * arg)
+{
+   long n = (long) arg ;
+   int i, block = n * (numblocks / NUMIO) ;
+   unsigned int start, lat ;
+   char *buffer = malloc (blocksize) ;
+
+   for (i = 0; i < READS; i++)
+   {
+      start = systime () ;
+      if (disk_block_read (block, buffer) < 0)
+         printf ("T%02d erro ao ler bloco %3d\n", task_id(), block) ;
+      lat = systime () - start ;
+
+      lat_sum[n] += lat ;
+      if (lat > lat_max[n])
+         lat_max[n] = lat ;
+      block = (block + 37) % numblocks ;
+   }
+
+   free (buffer) ;
+   io_done++ ;
+   task_exit (0) ;
+}
+
+int main (int argc, char *argv[])
+{
+   long i ;
+
+   printf ("main: inicio (classe de escalonamento %d)\n", ppos_get_scheduler ()) ;
+
+   ppos_init () ;
+
+   if (disk_mgr_init (&numblocks, &blocksize) < 0)
+   {
+      printf ("Erro na abertura do disco\n") ;
+      exit (1) ;
+   }
+
+   for (i = 0; i < NUMHOGS; i++)
+      task_create (&hog[i], hogBody, NULL) ;
+   for (i = 0; i < NUMIO; i++)
+      task_create (&io[i], ioBody, (void *) i) ;
+
+   for (i = 0; i < NUMIO; i++)
+      task_join (&io[i]) ;
+   for (i = 0; i < NUMHOGS; i++)
+      task_join (&hog[i]) ;
+
+   for (i = 0; i < NUMIO; i++)
+      printf ("io%ld: %d leituras, latencia media %6.1f ms, maxima %4u ms\n",
+              i, READS, (double) lat_sum[i] / READS, lat_max[i]) ;
+
+   printf ("main: fim em %d ms\n", systime ()) ;
+   task_exit (0) ;
+
+   exit (0) ;
+}
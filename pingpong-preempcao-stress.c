@@ -16,7 +16,8 @@ task_t task[NUMTASKS] ;
 // simula um processamento pesado
 int hardwork (int n)
 {
-   int i, j, soma ;
+   int i, j ;
+   volatile int soma ;
 
    soma = 0 ;
    for (i=0; i<n; i++)
@@ -15,7 +15,8 @@ task_t Pang, Peng, Ping, Pong, Pung ;
 // simula um processamento pesado
 int hardwork (int n)
 {
-   int i, j, soma ;
+   int i, j ;
+   volatile int soma ;
 
    soma = 0 ;
    for (i=0; i<n; i++)
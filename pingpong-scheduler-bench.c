@@ -0,0 +1,68 @@
+// PingPongOS - PingPong Operating System
+// Benchmark do escalonador: custo de uma decisão em função do número
+// de tarefas prontas (10 a 10.000)
+
+// Cada decisão é um ciclo scheduler() + task_resume() feito pela main: a
+// tarefa escolhida volta ao fim da fila de prontas, sem troca de contexto,
+// de modo que o tempo medido é o da política de escalonamento e da
+// manutenção da fila. As tarefas criadas nunca chegam a executar.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "ppos.h"
+
+#define MAXTASKS  10000
+#define DECISIONS 20000
+
+task_t task[MAXTASKS] ;
+
+// corpo das tarefas (nunca executado)
+void Body (void * arg)
+{
+   task_exit (0) ;
+}
+
+// relógio monotônico em nanossegundos
+double now_ns ()
+{
+   struct timespec ts ;
+
+   clock_gettime (CLOCK_MONOTONIC, &ts) ;
+   return (ts.tv_sec * 1e9 + ts.tv_nsec) ;
+}
+
+int main (int argc, char *argv[])
+{
+   int sizes[] = { 10, 100, 1000, 10000 } ;
+   int created = 0 ;
+   int i, d ;
+   double start, elapsed ;
+
+   printf ("main: inicio\n");
+
+   ppos_init () ;
+
+   printf ("%8s %10s %12s\n", "tarefas", "decisoes", "ns/decisao") ;
+
+   for (i = 0; i < sizeof (sizes) / sizeof (sizes[0]); i++)
+   {
+      // completa o conjunto de tarefas prontas, com prioridades variadas
+      while (created < sizes[i])
+      {
+         task_create (&task[created], Body, NULL) ;
+         task_setprio (&task[created], (created % 41) - 20) ;
+         created++ ;
+      }
+
+      start = now_ns () ;
+      for (d = 0; d < DECISIONS; d++)
+         task_resume (scheduler ()) ;
+      elapsed = now_ns () - start ;
+
+      printf ("%8d %10d %12.1f\n", created, DECISIONS, elapsed / DECISIONS) ;
+   }
+
+   printf ("main: fim\n");
+   exit (0);
+}
@@ -0,0 +1,71 @@
+// PingPongOS - PingPong Operating System
+
+// Teste do stride scheduling - tarefas com tickets distintos devem dividir
+// o processador na proporção dos tickets
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ppos.h"
+
+#define DURATION   10000  // duração da disputa pelo processador (ms)
+#define TOLERANCE  0.05   // desvio relativo aceito na fatia de cada tarefa
+#define NUMTASKS   4
+
+task_t task[NUMTASKS] ;
+char *name[NUMTASKS] = { "    Pang", "        Peng", "            Ping", "                Pong" } ;
+int tickets[NUMTASKS] = { 100, 200, 300, 400 } ;
+
+// corpo das threads: ocupa o processador até o fim da disputa
+void Body (void * arg)
+{
+   printf ("%s: inicio em %4d ms (tickets: %d)\n", (char *) arg,
+           systime(), task_getshare(NULL)) ;
+   while (systime() < DURATION) ;
+   printf ("%s: fim    em %4d ms\n", (char *) arg, systime()) ;
+   task_exit (0) ;
+}
+
+int main (int argc, char *argv[])
+{
+   int i, total_tickets = 0, errors = 0 ;
+   unsigned int total_time = 0 ;
+
+   printf ("main: inicio\n");
+
+   ppos_init () ;
+   ppos_set_scheduler (CPU_SCHED_STRIDE) ;
+
+   for (i=0; i<NUMTASKS; i++)
+   {
+      task_create (&task[i], Body, name[i]) ;
+      task_setshare (&task[i], tickets[i]) ;
+      total_tickets += tickets[i] ;
+   }
+
+   for (i=0; i<NUMTASKS; i++)
+      task_join (&task[i]) ;
+
+   for (i=0; i<NUMTASKS; i++)
+      total_time += task[i].proc_time ;
+
+   // fatia de processador obtida por tarefa, comparada à esperada
+   for (i=0; i<NUMTASKS; i++)
+   {
+      double expected = (double) tickets[i] / total_tickets ;
+      double obtained = (double) task[i].proc_time / total_time ;
+      double deviation = (obtained - expected) / expected ;
+
+      printf ("%s: %5u ms de processador, fatia %5.1f%% (esperada %5.1f%%, desvio %+5.1f%%)\n",
+              name[i], task[i].proc_time, obtained * 100, expected * 100, deviation * 100) ;
+      if (deviation > TOLERANCE || deviation < -TOLERANCE)
+         errors++ ;
+   }
+
+   if (errors)
+      printf ("main: %d tarefa(s) fora da proporcao dos tickets\n", errors) ;
+   else
+      printf ("main: fatias proporcionais aos tickets\n") ;
+
+   printf ("main: fim\n");
+   exit (errors ? 1 : 0);
+}
@@ -0,0 +1,80 @@
+// PingPongOS - PingPong Operating System
+// Benchmark da criação de tarefas: vazão de task_create + task_join
+
+// A main cria lotes de tarefas curtas, cada uma usando parte da pilha, e
+// espera por todas; o mesmo trabalho é repetido com pilhas do malloc (como
+// no núcleo original) e do pool, para dois tamanhos de pilha. A vazão inclui
+// a linha que after_task_exit imprime por tarefa: make bench-taskcreate
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ppos.h"
+
+#define BATCH     100             // tarefas criadas antes de cada join
+#define ROUNDS    200             // lotes por medição
+#define TOUCH     8192            // bytes de pilha usados por tarefa
+
+task_t task[BATCH] ;
+
+// corpo das tarefas: ocupa TOUCH bytes da pilha e termina
+void Body (void * arg)
+{
+   volatile char buf[TOUCH] ;
+
+   memset ((char *) buf, 1, TOUCH) ;
+   task_exit (buf[TOUCH - 1]) ;
+}
+
+// relógio monotônico em nanossegundos
+double now_ns ()
+{
+   struct timespec ts ;
+
+   clock_gettime (CLOCK_MONOTONIC, &ts) ;
+   return (ts.tv_sec * 1e9 + ts.tv_nsec) ;
+}
+
+// tarefas criadas e esperadas por segundo
+double run (size_t stacksize)
+{
+   int i, r ;
+   double start ;
+
+   start = now_ns () ;
+   for (r = 0; r < ROUNDS; r++)
+   {
+      for (i = 0; i < BATCH; i++)
+         task_create_ex (&task[i], Body, NULL, stacksize) ;
+      for (i = 0; i < BATCH; i++)
+         task_join (&task[i]) ;
+   }
+   return (BATCH * ROUNDS / ((now_ns () - start) / 1e9)) ;
+}
+
+int main (int argc, char *argv[])
+{
+   size_t sizes[] = { STACKSIZE, 256 * 1024 } ;
+   struct { char *name ; int flags ; } modes[] = {
+      { "malloc",  0 },
+      { "pool",    STACK_POOL | STACK_POOL_GUARD },
+   } ;
+   int s, m ;
+
+   printf ("main: inicio\n");
+
+   ppos_init () ;
+
+   printf ("%-16s %10s %14s\n", "pilhas", "tamanho", "tarefas/s") ;
+   for (s = 0; s < sizeof (sizes) / sizeof (sizes[0]); s++)
+      for (m = 0; m < sizeof (modes) / sizeof (modes[0]); m++)
+      {
+         ppos_set_stack_pool (modes[m].flags) ;
+         printf ("%-16s %6zu KiB %14.0f\n", modes[m].name, sizes[s] / 1024,
+                 run (sizes[s])) ;
+      }
+
+   printf ("main: fim\n");
+   exit (0);
+}
@@ -12,8 +12,14 @@
  */
 
 #define _XOPEN_SOURCE 600           
+#define _DEFAULT_SOURCE             // MAP_ANONYMOUS (pool de pilhas)
 
+#include <limits.h>
 #include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include <sys/time.h>
 #include "ppos.h"
 #include "ppos-core-globals.h"
@@ -34,20 +40,868 @@
 #define MAIS_PRIO           <
 #define MENOS_PRIO          >
 
+// Classe de escalonamento da CPU na inicialização (-DCPU_SCHED=CPU_SCHED_...)
+#ifndef CPU_SCHED
+#define CPU_SCHED  CPU_SCHED_PRIO
+#endif
+
+// Tempo estimado de tarefas sem task_set_eet: ficam atrás das demais no SRTF
+#define EET_UNKNOWN   INT_MAX
+
+// Prazo de tarefas sem task_set_deadline: ficam atrás das demais no EDF
+#define DEADLINE_NONE UINT_MAX
+
 // Configuração do sistema de tempo
 #define QUANTUM_SIZE       20   // Quantum em ticks (20ms)
 #define TIMER_INTERVAL   1000   // Timer dispara a cada 1ms
 
+// Pool de pilhas: classes de STACK_POOL_MIN << c bytes, até STACK_POOL_KEEP
+// pilhas livres por classe; pedidos maiores que a última classe não voltam ao pool
+#define STACK_POOL_MIN      16384
+#define STACK_POOL_CLASSES  8       // 16 KiB a 2 MiB
+#define STACK_POOL_KEEP     128
+#define STACK_MALLOC        (-1)    // Pilha do malloc, liberada pelo núcleo
+
 
 // Variáveis globais do sistema
 
-unsigned int _systemTime;               // Relógio global em milissegundos
-static struct sigaction timer_action;   // Handler para SIGALRM
-static struct itimerval timer;          // Configuração do timer UNIX
+volatile unsigned int _systemTime;      // Relógio global em milissegundos
+static int cpu_policy = CPU_SCHED;      // Política de escalonamento ativa
+static struct sigaction timer_action;   // Handler para SIGALRM
+static struct itimerval timer;          // Configuração do timer UNIX
+#ifdef PPOS_FAST_SWITCH
+static sigset_t timer_mask;             // Só SIGALRM (liberado na preempção)
+#endif
+
+// Protótipos das funções auxiliares
+static void interrupt_handler(int signum);
+static void timer_init(void);
+static void stack_reap(void);
+static void stack_retire(task_t* task);
+
+/**
+ * ============================================================================
+ * FILA DE PRONTAS E CLASSES DE ESCALONAMENTO
+ * ============================================================================
+ */
+
+/**
+ * A readyQueue do núcleo é espelhada, pelos hooks, na estrutura da classe
+ * de escalonamento ativa. Cada classe implementa as operações abaixo; o
+ * scheduler() só chama pick_next e o interrupt_handler só chama tick.
+ *
+ * As classes guardam as tarefas prontas em pairing heaps intrusivos (nó
+ * rq_node na TCB), cada uma com sua ordem. A chave de uma tarefa só muda
+ * com ela fora do heap (em execução) ou por uma retirada e reinserção.
+ *
+ * Main e dispatcher têm TCB alocada dentro do ppos-all.o, sem os campos
+ * estendidos da task_t; ficam em slots próprios e só são escolhidas quando
+ * não há tarefa de usuário pronta, qualquer que seja a classe.
+ */
+
+typedef struct sched_class_t
+{
+   const char* name ;
+   void    (*init) (void) ;             // Estado inicial (fila vazia)
+   void    (*enqueue) (task_t* task) ;  // Tarefa entrou na fila de prontas
+   void    (*dequeue) (task_t* task) ;  // Tarefa saiu sem passar pelo dispatcher
+   task_t* (*pick_next) (void) ;        // Retira a próxima tarefa a executar
+   void    (*tick) (task_t* task) ;     // Tick do relógio da tarefa em execução
+   int     (*preempts) (task_t* task) ; // Tarefa recém-pronta toma o processador? (opcional)
+   int     (*slice) (task_t* task) ;    // Quantum ao ganhar o processador (opcional)
+} sched_class_t ;
+
+static sched_class_t* cpu_class;            // Classe ativa
+static unsigned int rq_nr_ready;            // Tarefas de usuário no espelho
+static volatile sig_atomic_t rq_need_resched; // Preempção pendente para o próximo tick
+static task_t* rq_core[2];                  // Slots de main (0) e dispatcher (1)
+static unsigned int rq_core_wait;           // Decisões desde que main ficou pronta
+
+// Decisões que main pronta espera por tarefas de usuário: o mesmo que o aging
+// leva para trazer uma tarefa da menor à maior prioridade
+#define CORE_WAIT_MAX    (PRIORITY_MIN - PRIORITY_MAX + 1)
+
+// Ordem de um heap: a vem antes de b
+typedef int (*rq_before_t)(task_t* a, task_t* b);
+
+// TCB que contém um nó da fila de prontas
+#define RQ_TASK(node)    ((task_t*)((char*)(node) - offsetof(task_t, rq_node)))
+
+// Indica se a tarefa está na readyQueue do núcleo
+#define IN_READY_QUEUE(task) ((void*)(task)->queue == (void*)&readyQueue)
+
+static inline int is_core_task(task_t* task) {
+    return task->id <= 1;
+}
+
+// Só tarefas de usuário têm os campos estendidos; user_task não existe nas do núcleo
+static inline int is_user_task(task_t* task) {
+    return !is_core_task(task) && task->user_task;
+}
+
+/**
+ * ----------------------------------------------------------------------------
+ * Pairing heap intrusivo
+ * ----------------------------------------------------------------------------
+ */
+
+// Funde dois heaps soltos; a raiz que vem primeiro vira pai da outra
+static rqnode_t* rq_meld(rqnode_t* a, rqnode_t* b, rq_before_t before) {
+    if (!a) return b;
+    if (!b) return a;
+
+    if (before(RQ_TASK(b), RQ_TASK(a))) {
+        rqnode_t* tmp = a;
+        a = b;
+        b = tmp;
+    }
+
+    b->prev    = a;
+    b->sibling = a->child;
+    if (a->child) {
+        a->child->prev = b;
+    }
+    a->child = b;
+
+    return a;
+}
+
+// Funde uma lista de irmãos em um único heap (duas passadas)
+static rqnode_t* rq_merge_pairs(rqnode_t* first, rq_before_t before) {
+    rqnode_t* pairs = NULL;
+
+    // Primeira passada: funde aos pares, empilhando os resultados
+    while (first) {
+        rqnode_t* a = first;
+        rqnode_t* b = a->sibling;
+        first = b ? b->sibling : NULL;
+
+        a->prev = a->sibling = NULL;
+        if (b) {
+            b->prev = b->sibling = NULL;
+        }
+        a = rq_meld(a, b, before);
+        a->sibling = pairs;
+        pairs = a;
+    }
+
+    // Segunda passada: funde a pilha da direita para a esquerda
+    rqnode_t* root = NULL;
+    while (pairs) {
+        rqnode_t* next = pairs->sibling;
+        pairs->sibling = NULL;
+        root = rq_meld(pairs, root, before);
+        pairs = next;
+    }
+
+    return root;
+}
+
+// Pendura um heap na âncora (child aponta a raiz)
+static void rq_set_root(rqnode_t* anchor, rqnode_t* root) {
+    anchor->child = root;
+    if (root) {
+        root->prev    = anchor;
+        root->sibling = NULL;
+    }
+}
+
+// Insere a tarefa no heap da âncora indicada
+static void rq_insert(rqnode_t* anchor, task_t* task, rq_before_t before) {
+    rqnode_t* node = &task->rq_node;
+    rqnode_t* root = anchor->child;
+
+    node->child = node->sibling = node->prev = NULL;
+    if (root) {
+        root->prev = NULL;
+    }
+    rq_set_root(anchor, rq_meld(root, node, before));
+}
+
+// Remove a tarefa do heap da âncora, qualquer que seja sua posição
+static void rq_remove(rqnode_t* anchor, task_t* task, rq_before_t before) {
+    rqnode_t* node = &task->rq_node;
+    rqnode_t* prev = node->prev;
+
+    // Desliga o nó de quem aponta para ele (pai/âncora ou irmão anterior)
+    if (prev->child == node) {
+        prev->child = node->sibling;
+    }
+    else {
+        prev->sibling = node->sibling;
+    }
+    if (node->sibling) {
+        node->sibling->prev = prev;
+    }
+
+    // Filhos do nó voltam ao heap
+    rqnode_t* orphans = rq_merge_pairs(node->child, before);
+    rqnode_t* root    = anchor->child;
+    if (root) {
+        root->prev = NULL;
+    }
+    rq_set_root(anchor, rq_meld(root, orphans, before));
+
+    node->child = node->sibling = node->prev = NULL;
+}
+
+// Retira e retorna a raiz do heap da âncora (não vazio)
+static task_t* rq_pop(rqnode_t* anchor, rq_before_t before) {
+    rqnode_t* root = anchor->child;
+
+    rq_set_root(anchor, rq_merge_pairs(root->child, before));
+    root->child = root->sibling = root->prev = NULL;
+
+    return RQ_TASK(root);
+}
+
+static int before_by_id(task_t* a, task_t* b) {
+    return a->id < b->id;
+}
+
+/**
+ * ----------------------------------------------------------------------------
+ * Round-robin: ordem de chegada na fila de prontas
+ * ----------------------------------------------------------------------------
+ */
+
+static rqnode_t rr_heap;
+static unsigned int rr_arrivals;            // Chegadas à fila desde o boot
+
+static int rr_before(task_t* a, task_t* b) {
+    return (int)(a->ready_epoch - b->ready_epoch) < 0;
+}
+
+static void rr_init(void) {
+    rr_heap.child = rr_heap.sibling = rr_heap.prev = NULL;
+    rr_arrivals = 0;
+}
+
+static void rr_enqueue(task_t* task) {
+    task->ready_epoch = rr_arrivals++;
+    rq_insert(&rr_heap, task, rr_before);
+}
+
+static void rr_dequeue(task_t* task) {
+    rq_remove(&rr_heap, task, rr_before);
+}
+
+static task_t* rr_pick_next(void) {
+    return rr_heap.child ? rq_pop(&rr_heap, rr_before) : NULL;
+}
+
+static void rr_tick(task_t* task) {
+}
+
+static sched_class_t rr_class = {
+    "RR", rr_init, rr_enqueue, rr_dequeue, rr_pick_next, rr_tick, NULL, NULL
+};
+
+/**
+ * ----------------------------------------------------------------------------
+ * Prioridades com aging
+ * ----------------------------------------------------------------------------
+ *
+ * Um heap por nível de prioridade (-20 a +20), ordenado por ID para
+ * preservar o desempate, e um bitmap dos níveis não vazios. Escolher a
+ * próxima tarefa custa um find-first-set mais a remoção do mínimo do heap.
+ *
+ * O aging é preguiçoso: cada decisão que escolhe uma tarefa de usuário
+ * avança a época do escalonador, e a prioridade efetiva de uma tarefa pronta
+ * é derivada, só quando necessária, do valor com que entrou na fila e das
+ * épocas decorridas desde então, saturada em PRIORITY_MAX. Para que o índice
+ * acompanhe sem tocar nas TCBs, os níveis formam um anel cuja origem avança
+ * com a época; o heap do nível -19 é fundido (O(1), pairing heap) ao do
+ * nível -20, que absorve as saturadas.
+ */
+
+#define PRIORITY_LEVELS  (PRIORITY_MIN - PRIORITY_MAX + 1)   // 41 níveis
+
+// O anel avança um nível por época
+#if PRIORITY_ALPHA != -1
+#error "A fila de prontas assume aging de um nível por decisão (PRIORITY_ALPHA = -1)"
+#endif
+
+static rqnode_t prio_level[PRIORITY_LEVELS];  // Âncoras: child aponta a raiz do heap
+static unsigned int rq_origin;                // Posição no anel do nível -20
+static unsigned int sched_epoch;              // Decisões com aging desde o boot
+static unsigned long long rq_bitmap;          // Bit n = nível n (prio n-20) não vazio
+
+// Âncora do heap de um nível lógico (0 = prioridade -20)
+#define PRIO_SLOT(level)   (&prio_level[((level) + rq_origin) % PRIORITY_LEVELS])
+
+static int prio_to_level(int prio) {
+    if (prio MAIS_PRIO PRIORITY_MAX)  prio = PRIORITY_MAX;
+    if (prio MENOS_PRIO PRIORITY_MIN) prio = PRIORITY_MIN;
+    return prio - PRIORITY_MAX;
+}
+
+/**
+ * Nível efetivo de uma tarefa pronta: o nível com que entrou na fila menos
+ * as épocas decorridas, saturado no nível 0 (PRIORITY_MAX)
+ */
+static int rq_task_level(task_t* task) {
+    unsigned int elapsed = sched_epoch - task->ready_epoch;
+    int level = prio_to_level(task->prio_dynamic);
+
+    return (elapsed >= (unsigned int)level) ? 0 : level - (int)elapsed;
+}
+
+// Atualiza o bit do nível conforme o heap ficou vazio ou não
+static void prio_update_bitmap(int level) {
+    if (PRIO_SLOT(level)->child) {
+        rq_bitmap |= 1ULL << level;
+    }
+    else {
+        rq_bitmap &= ~(1ULL << level);
+    }
+}
+
+static void prio_init(void) {
+    for (int i = 0; i < PRIORITY_LEVELS; i++) {
+        prio_level[i].child = prio_level[i].sibling = prio_level[i].prev = NULL;
+    }
+    rq_origin   = 0;
+    sched_epoch = 0;
+    rq_bitmap   = 0;
+}
+
+static void prio_enqueue(task_t* task) {
+    int level = prio_to_level(task->prio_dynamic);
+
+    task->ready_epoch = sched_epoch;
+    rq_insert(PRIO_SLOT(level), task, before_by_id);
+    rq_bitmap |= 1ULL << level;
+}
+
+// Materializa em prio_dynamic o aging acumulado na fila
+static void prio_dequeue(task_t* task) {
+    int level = rq_task_level(task);
+
+    rq_remove(PRIO_SLOT(level), task, before_by_id);
+    prio_update_bitmap(level);
+    task->prio_dynamic = level + PRIORITY_MAX;
+}
+
+/**
+ * Aging de todas as tarefas prontas em O(1): a época avança, o heap do
+ * nível -20 é fundido ao do nível -19 e a origem do anel avança, de modo
+ * que cada heap passa a representar o nível imediatamente mais prioritário.
+ */
+static void prio_age(void) {
+    rqnode_t* top  = PRIO_SLOT(0);
+    rqnode_t* next = PRIO_SLOT(1);
+
+    if (top->child) {
+        rqnode_t* a = top->child;
+        rqnode_t* b = next->child;
+
+        a->prev = NULL;
+        if (b) {
+            b->prev = NULL;
+        }
+        rq_set_root(next, rq_meld(a, b, before_by_id));
+        top->child = NULL;
+    }
+
+    sched_epoch++;
+    rq_origin = (rq_origin + 1) % PRIORITY_LEVELS;
+    rq_bitmap = (rq_bitmap >> 1) | (rq_bitmap & 1);
+}
+
+static task_t* prio_pick_next(void) {
+    if (!rq_bitmap) {
+        return NULL;
+    }
+
+    // Melhor nível não vazio; menor ID dentro dele
+    int level = __builtin_ctzll(rq_bitmap);
+    task_t* better = rq_pop(PRIO_SLOT(level), before_by_id);
+    prio_update_bitmap(level);
+
+    // Aging das demais e reset da escolhida à prioridade original
+    prio_age();
+    better->prio_dynamic = better->prio_static;
+
+    return better;
+}
+
+static void prio_tick(task_t* task) {
+}
+
+static sched_class_t prio_class = {
+    "PRIO", prio_init, prio_enqueue, prio_dequeue, prio_pick_next, prio_tick, NULL, NULL
+};
+
+/**
+ * ----------------------------------------------------------------------------
+ * SRTF: menor tempo restante estimado primeiro
+ * ----------------------------------------------------------------------------
+ *
+ * Todas as tarefas prontas em um único heap, ordenado pelo tempo restante
+ * e, no empate, pela ordem de chegada: as de mesmo tempo restante (as sem
+ * estimativa, por exemplo) se revezam como no round-robin. Uma tarefa
+ * pronta mais curta que a atual toma o processador de imediato, sem
+ * esperar o fim do quantum.
+ */
+
+static rqnode_t srtf_heap;
+static unsigned int srtf_arrivals;          // Chegadas à fila desde o boot
+
+static int srtf_before(task_t* a, task_t* b) {
+    if (a->remaining_time != b->remaining_time) {
+        return a->remaining_time < b->remaining_time;
+    }
+    return (int)(a->ready_epoch - b->ready_epoch) < 0;
+}
+
+static void srtf_init(void) {
+    srtf_heap.child = srtf_heap.sibling = srtf_heap.prev = NULL;
+    srtf_arrivals = 0;
+}
+
+static void srtf_enqueue(task_t* task) {
+    task->ready_epoch = srtf_arrivals++;
+    rq_insert(&srtf_heap, task, srtf_before);
+}
+
+static void srtf_dequeue(task_t* task) {
+    rq_remove(&srtf_heap, task, srtf_before);
+}
+
+static task_t* srtf_pick_next(void) {
+    return srtf_heap.child ? rq_pop(&srtf_heap, srtf_before) : NULL;
+}
+
+static void srtf_tick(task_t* task) {
+    if (task->remaining_time > 0 && task->remaining_time != EET_UNKNOWN) {
+        task->remaining_time--;
+    }
+}
+
+static int srtf_preempts(task_t* task) {
+    return task->remaining_time < taskExec->remaining_time;
+}
+
+static sched_class_t srtf_class = {
+    "SRTF", srtf_init, srtf_enqueue, srtf_dequeue, srtf_pick_next, srtf_tick, srtf_preempts, NULL
+};
+
+/**
+ * ----------------------------------------------------------------------------
+ * Stride scheduling: fatia de CPU proporcional aos tickets
+ * ----------------------------------------------------------------------------
+ *
+ * Cada tarefa avança seu passo (pass) de STRIDE1 / tickets a cada tick em
+ * que executa; a escolhida é a de menor passo. Os tickets são definidos por
+ * task_setshare() ou, sem isso, vêm da prioridade estática (-20 = 41
+ * tickets, +20 = 1). Quem entra na fila com passo atrás do tempo virtual (a
+ * última escolhida) é trazida até ele, para que tempo bloqueada não vire
+ * crédito.
+ */
+
+#define STRIDE1      (1 << 20)
+#define TICKETS_MAX  STRIDE1        // Acima disso o avanço por tick seria 0
+
+static rqnode_t stride_heap;
+static unsigned long long stride_vtime;     // Passo da última tarefa escolhida
+
+static int stride_before(task_t* a, task_t* b) {
+    if (a->pass != b->pass) {
+        return a->pass < b->pass;
+    }
+    return a->id < b->id;
+}
+
+static void stride_init(void) {
+    stride_heap.child = stride_heap.sibling = stride_heap.prev = NULL;
+    stride_vtime = 0;
+}
+
+// Tickets da tarefa: definidos por task_setshare ou derivados da prioridade
+static int stride_tickets(task_t* task) {
+    return task->tickets ? task->tickets : PRIORITY_MIN - task->prio_static + 1;
+}
+
+static void stride_enqueue(task_t* task) {
+    task->stride = STRIDE1 / stride_tickets(task);
+    if (task->pass < stride_vtime) {
+        task->pass = stride_vtime;
+    }
+    rq_insert(&stride_heap, task, stride_before);
+}
+
+static void stride_dequeue(task_t* task) {
+    rq_remove(&stride_heap, task, stride_before);
+}
+
+static task_t* stride_pick_next(void) {
+    if (!stride_heap.child) {
+        return NULL;
+    }
+
+    task_t* better = rq_pop(&stride_heap, stride_before);
+    stride_vtime = better->pass;
+
+    return better;
+}
+
+static void stride_tick(task_t* task) {
+    task->pass += task->stride;
+}
+
+static sched_class_t stride_class = {
+    "STRIDE", stride_init, stride_enqueue, stride_dequeue, stride_pick_next, stride_tick, NULL, NULL
+};
+
+/**
+ * ----------------------------------------------------------------------------
+ * EDF: prazo absoluto mais próximo primeiro
+ * ----------------------------------------------------------------------------
+ *
+ * Tarefas sem prazo (DEADLINE_NONE) ficam atrás das demais; no empate vale
+ * a ordem de chegada, para que as sem prazo se revezem. Uma tarefa pronta
+ * com prazo anterior ao da atual toma o processador.
+ *
+ * Tarefas periódicas (task_set_period) executam um job por período, com
+ * prazo no fim do período. O job termina quando a tarefa dorme; ao voltar à
+ * fila começa o seguinte, com o orçamento renovado, nunca antes de um
+ * período após o início do anterior. Um job que
+ * esgota o orçamento é adiado para o período seguinte (prazo e orçamento
+ * novos) e cede o processador: não pode atrasar as demais além do que
+ * declarou, mas continua usando o processador ocioso. A admissão recusa
+ * conjuntos com utilização (soma de budget/period) acima de 1.
+ */
+
+#define EDF_LOAD_MAX  1000000UL     // Utilização 1, em milionésimos
+
+static rqnode_t edf_heap;
+static unsigned int edf_arrivals;   // Chegadas à fila desde o boot
+static unsigned long edf_load;      // Utilização das tarefas admitidas
+
+// Utilização de uma tarefa periódica, em milionésimos
+static unsigned long edf_task_load(unsigned int budget, unsigned int period) {
+    return period ? (unsigned long)budget * EDF_LOAD_MAX / period : 0;
+}
+
+/**
+ * Início do próximo job: no fim do período corrente ou, se a tarefa acordou
+ * depois dele, agora (como a espera é feita com task_sleep, em segundos, a
+ * liberação acompanha o despertar em vez de seguir uma grade fixa)
+ */
+static void edf_job_start(task_t* task) {
+    unsigned int now  = systime();
+    unsigned int next = task->release + task->period;
+
+    task->release     = (now > next) ? now : next;
+    task->deadline    = task->release + task->period;
+    task->budget_left = task->budget;
+    task->job_active  = 1;
+}
+
+// Fim do job corrente: conta a perda de prazo
+static void edf_job_end(task_t* task) {
+    if (task->period && task->job_active) {
+        if (systime() > task->deadline) {
+            task->deadline_misses++;
+        }
+        task->job_active = 0;
+    }
+}
+
+static int edf_before(task_t* a, task_t* b) {
+    if (a->deadline != b->deadline) {
+        return a->deadline < b->deadline;
+    }
+    return (int)(a->ready_epoch - b->ready_epoch) < 0;
+}
+
+static void edf_init(void) {
+    edf_heap.child = edf_heap.sibling = edf_heap.prev = NULL;
+    edf_arrivals = 0;
+}
+
+static void edf_enqueue(task_t* task) {
+    if (task->period && !task->job_active) {
+        edf_job_start(task);
+    }
+    task->ready_epoch = edf_arrivals++;
+    rq_insert(&edf_heap, task, edf_before);
+}
+
+static void edf_dequeue(task_t* task) {
+    rq_remove(&edf_heap, task, edf_before);
+}
+
+static task_t* edf_pick_next(void) {
+    return edf_heap.child ? rq_pop(&edf_heap, edf_before) : NULL;
+}
+
+// Controle do orçamento do job em execução
+static void edf_tick(task_t* task) {
+    if (!task->period || --task->budget_left > 0) {
+        return;
+    }
+
+    // Orçamento esgotado: job adiado para o próximo período
+    task->budget_overruns++;
+    task->release    += task->period;
+    task->deadline    = task->release + task->period;
+    task->budget_left = task->budget;
+
+    task->quantum = 0;      // interrupt_handler cede o processador
+}
+
+static int edf_preempts(task_t* task) {
+    return task->deadline < taskExec->deadline;
+}
+
+static sched_class_t edf_class = {
+    "EDF", edf_init, edf_enqueue, edf_dequeue, edf_pick_next, edf_tick, edf_preempts, NULL
+};
+
+/**
+ * ----------------------------------------------------------------------------
+ * MLFQ: filas multinível com realimentação
+ * ----------------------------------------------------------------------------
+ *
+ * Uma fila por nível, em ordem de chegada, e um bitmap dos níveis não
+ * vazios. Toda tarefa começa no nível 0, de quantum curto; quem consome
+ * todo o tempo a que tem direito no nível (somado entre ativações, para que
+ * ceder o processador pouco antes do fim não evite a descida) desce um
+ * nível, onde o quantum dobra. Tarefas que bloqueiam cedo (semáforos,
+ * disco) ficam no alto e, ao acordar, tomam o processador das de nível mais
+ * baixo no próximo tick.
+ *
+ * A cada MLFQ_BOOST_PERIOD todas voltam ao nível 0 (verificado a cada
+ * decisão do escalonador): as filas são fundidas na do nível 0 e a época
+ * de boost avança; o nível gravado em uma TCB só vale se sua época for a
+ * atual, de modo que as tarefas fora da fila (bloqueadas, em execução) são
+ * promovidas sem serem visitadas.
+ */
+
+#define MLFQ_LEVELS         4      // Níveis (0 = mais prioritário)
+#define MLFQ_SLICE_BASE     5      // Quantum do nível 0 (ticks); dobra a cada nível
+#define MLFQ_BOOST_PERIOD   1000   // Intervalo entre boosts (ticks)
+
+static rqnode_t mlfq_queue[MLFQ_LEVELS];
+static unsigned int mlfq_bitmap;            // Bit n = nível n não vazio
+static unsigned int mlfq_arrivals;          // Chegadas à fila desde o boot
+static unsigned int mlfq_epoch;             // Boosts desde o boot
+static unsigned int mlfq_last_boost;        // Instante do último boost
+
+static int mlfq_before(task_t* a, task_t* b) {
+    return (int)(a->ready_epoch - b->ready_epoch) < 0;
+}
+
+// Descarta nível e consumo anteriores ao último boost
+static void mlfq_sync(task_t* task) {
+    if (task->mlfq_epoch != mlfq_epoch) {
+        task->mlfq_epoch = mlfq_epoch;
+        task->mlfq_level = 0;
+        task->mlfq_used  = 0;
+    }
+}
+
+static int mlfq_level_of(task_t* task) {
+    return (task->mlfq_epoch == mlfq_epoch) ? (int)task->mlfq_level : 0;
+}
+
+// Todas as prontas voltam ao nível 0, preservando a ordem de chegada
+static void mlfq_boost(void) {
+    if (systime() - mlfq_last_boost < MLFQ_BOOST_PERIOD) {
+        return;
+    }
+    mlfq_last_boost = systime();
+
+    rqnode_t* root = mlfq_queue[0].child;
+    if (root) {
+        root->prev = NULL;
+    }
+    for (int level = 1; level < MLFQ_LEVELS; level++) {
+        rqnode_t* other = mlfq_queue[level].child;
+        if (other) {
+            other->prev = NULL;
+            root = rq_meld(root, other, mlfq_before);
+            mlfq_queue[level].child = NULL;
+        }
+    }
+    rq_set_root(&mlfq_queue[0], root);
+
+    mlfq_bitmap = root ? 1 : 0;
+    mlfq_epoch++;
+}
+
+static void mlfq_init(void) {
+    for (int level = 0; level < MLFQ_LEVELS; level++) {
+        mlfq_queue[level].child = mlfq_queue[level].sibling = mlfq_queue[level].prev = NULL;
+    }
+    mlfq_bitmap     = 0;
+    mlfq_arrivals   = 0;
+    mlfq_epoch      = 0;
+    mlfq_last_boost = systime();
+}
+
+static void mlfq_enqueue(task_t* task) {
+    mlfq_sync(task);
+    task->ready_epoch = mlfq_arrivals++;
+    rq_insert(&mlfq_queue[task->mlfq_level], task, mlfq_before);
+    mlfq_bitmap |= 1U << task->mlfq_level;
+}
+
+static void mlfq_dequeue(task_t* task) {
+    mlfq_sync(task);
+    rq_remove(&mlfq_queue[task->mlfq_level], task, mlfq_before);
+    if (!mlfq_queue[task->mlfq_level].child) {
+        mlfq_bitmap &= ~(1U << task->mlfq_level);
+    }
+}
+
+static task_t* mlfq_pick_next(void) {
+    mlfq_boost();
+    if (!mlfq_bitmap) {
+        return NULL;
+    }
+
+    int level = __builtin_ctz(mlfq_bitmap);
+    task_t* better = rq_pop(&mlfq_queue[level], mlfq_before);
+    if (!mlfq_queue[level].child) {
+        mlfq_bitmap &= ~(1U << level);
+    }
+
+    return better;
+}
+
+// Consumo no nível; esgotado o tempo a que tem direito, a tarefa desce. O
+// boost fica para o pick_next: o tick pode interromper um hook no meio de
+// uma operação sobre as filas
+static void mlfq_tick(task_t* task) {
+    mlfq_sync(task);
+
+    if (++task->mlfq_used >= (unsigned int)(MLFQ_SLICE_BASE << task->mlfq_level)) {
+        if (task->mlfq_level < MLFQ_LEVELS - 1) {
+            task->mlfq_level++;
+        }
+        task->mlfq_used = 0;
+    }
+}
+
+static int mlfq_preempts(task_t* task) {
+    return mlfq_level_of(task) < mlfq_level_of(taskExec);
+}
+
+// Quantum: a fatia inteira do nível. A descida é contada à parte, pelo
+// consumo acumulado; um quantum de poucos ticks poderia esgotar entre o
+// after_task_switch e a troca de contexto, com o dispatcher ainda em execução
+static int mlfq_slice(task_t* task) {
+    mlfq_sync(task);
+    return MLFQ_SLICE_BASE << task->mlfq_level;
+}
+
+static sched_class_t mlfq_class = {
+    "MLFQ", mlfq_init, mlfq_enqueue, mlfq_dequeue, mlfq_pick_next, mlfq_tick, mlfq_preempts,
+    mlfq_slice
+};
+
+/**
+ * ----------------------------------------------------------------------------
+ * Espelho da readyQueue
+ * ----------------------------------------------------------------------------
+ */
+
+// Classe de cada política CPU_SCHED_*
+static sched_class_t* sched_class_of(int policy) {
+    switch (policy) {
+        case CPU_SCHED_RR:     return &rr_class;
+        case CPU_SCHED_PRIO:   return &prio_class;
+        case CPU_SCHED_SRTF:   return &srtf_class;
+        case CPU_SCHED_STRIDE: return &stride_class;
+        case CPU_SCHED_EDF:    return &edf_class;
+        case CPU_SCHED_MLFQ:   return &mlfq_class;
+        default:               return NULL;
+    }
+}
+
+static void rq_init(void) {
+    if (!cpu_class) {
+        cpu_class = sched_class_of(cpu_policy);
+    }
+    cpu_class->init();
+    rq_nr_ready = 0;
+    rq_core[0] = rq_core[1] = NULL;
+}
+
+// Retira uma tarefa que saiu da readyQueue sem passar pelo dispatcher
+static void rq_dequeue(task_t* task) {
+    if (is_core_task(task)) {
+        if (rq_core[task->id] == task) {
+            rq_core[task->id] = NULL;
+        }
+        return;
+    }
+    if (task->rq_node.prev) {
+        cpu_class->dequeue(task);
+        rq_nr_ready--;
+    }
+}
+
+/**
+ * Registra uma tarefa que entrou na readyQueue. Se ela já estava na fila,
+ * é reinserida, como faz o núcleo com queue_remove seguido de queue_append.
+ */
+static void rq_enqueue(task_t* task) {
+    if (is_core_task(task)) {
+        if (rq_core[task->id] != task) {
+            rq_core_wait = 0;
+        }
+        rq_core[task->id] = task;
+        return;
+    }
+    if (task->rq_node.prev) {
+        rq_dequeue(task);
+    }
+    cpu_class->enqueue(task);
+    rq_nr_ready++;
+}
+
+// Reconstrói o espelho a partir da readyQueue (tarefas inseridas sem hook)
+static void rq_rebuild(void) {
+    task_t* current = readyQueue;
+    do {
+        if (is_core_task(current) ? rq_core[current->id] != current
+                                  : current->rq_node.prev == NULL) {
+            rq_enqueue(current);
+        }
+        current = current->next;
+    } while (current != readyQueue);
+}
+
+/**
+ * Uma tarefa que acaba de ficar pronta toma o processador se a classe
+ * assim decidir (SRTF, EDF); só tarefas de usuário são preemptadas
+ */
+static void rq_check_preempt(task_t* task) {
+    if (!cpu_class->preempts || task == taskExec || !is_user_task(taskExec)) {
+        return;
+    }
+    if (task->rq_node.prev && cpu_class->preempts(task)) {
+        task_yield();
+    }
+}
 
-// Protótipos das funções auxiliares
-static void interrupt_handler(int signum);
-static void timer_init(void);
+/**
+ * Como rq_check_preempt, mas para tarefas acordadas dentro de operações do
+ * núcleo (task_resume em sem_up, task_exit...), onde não se pode ceder o
+ * processador: a troca fica para o próximo tick
+ */
+static void rq_defer_preempt(task_t* task) {
+    if (!cpu_class->preempts || task == taskExec || !is_user_task(taskExec)) {
+        return;
+    }
+    if (task->rq_node.prev && cpu_class->preempts(task)) {
+        rq_need_resched = 1;
+    }
+}
 
 /**
  * ============================================================================
@@ -56,74 +910,118 @@ static void timer_init(void);
  */
 
 /**
- * Escalonador por prioridades com aging
- * 
- * Política: menor valor = maior prioridade, aging diminui valores das 
- * não-escolhidas, desempate por ID (FIFO). Apenas tarefas de usuário 
- * participam do aging.
+ * Escolhe a próxima tarefa conforme a classe ativa (por padrão, prioridades
+ * com aging: menor valor = maior prioridade, aging diminui valores das
+ * não-escolhidas, desempate por ID). Main e dispatcher só são escolhidas
+ * quando não há tarefa de usuário pronta, ou, no caso de main, depois de
+ * CORE_WAIT_MAX decisões à espera (um gerente de disco sempre pronto não a
+ * deixa sem processador).
  */
 task_t* scheduler() {
 
     PPOS_PREEMPT_DISABLE;   // Protege estruturas do escalonador
-    
+
+    // A tarefa que encerrou já saiu da própria pilha
+    stack_reap();
+
     if (readyQueue == NULL) {
         PPOS_PREEMPT_ENABLE;
         return NULL;
     }
 
-    // Busca tarefa com melhor prioridade dinâmica
-    task_t* better  = readyQueue;
-    task_t* current = readyQueue;
+    if (!rq_nr_ready && !rq_core[0] && !rq_core[1]) {
+        rq_rebuild();
+    }
 
     #ifdef DEBUG02
-    printf("\n[SCHED] Tarefas prontas:");
+    printf("\n[SCHED %s] Tarefas prontas:", cpu_class->name);
+    task_t* current = readyQueue;
     do {
-        printf("\nT%d(prio=%d)", current->id, current->prio_dynamic);
+        if (!is_core_task(current) && current->rq_node.prev) {
+            if (cpu_class == &prio_class) {
+                printf("\nT%d(prio=%d)", current->id,
+                       rq_task_level(current) + PRIORITY_MAX);
+            }
+            else {
+                printf("\nT%d", current->id);
+            }
+        }
         current = current->next;
     } while (current != readyQueue);
     printf("\n");
     #endif
 
-    // Encontra melhor tarefa: menor prioridade dinâmica, menor ID em empates
-    do {
-        if ((current->prio_dynamic  < better->prio_dynamic) || 
-            (current->prio_dynamic == better->prio_dynamic  &&
-             current->id < better->id))
-        {
-            better = current;
+    task_t* better = NULL;
+
+    if (rq_nr_ready && !(rq_core[0] && rq_core_wait >= CORE_WAIT_MAX)) {
+        better = cpu_class->pick_next();
+        rq_nr_ready--;
+        rq_core_wait++;
+    }
+    else {
+        better = rq_core[0] ? rq_core[0] : rq_core[1];
+        if (better) {
+            rq_core[better->id] = NULL;
         }
-        current = current->next;
     }
-    while (current != readyQueue);
 
     #ifdef DEBUG02
-    printf("→ Escolhida: T%d\n", better->id);
+    if (better) printf("→ Escolhida: T%d\n", better->id);
     #endif
 
-    // Aging: apenas para tarefas de usuário (user_task = 1)
-    if (better->user_task) {
-        current = readyQueue;
+    // Escolhida na cabeça: o queue_remove do dispatcher a encontra de imediato
+    if (better) {
+        readyQueue = better;
+    }
+
+    PPOS_PREEMPT_ENABLE;
+    return better;
+}
+
+/**
+ * Troca a classe de escalonamento em tempo de execução: as tarefas prontas
+ * saem da estrutura da classe atual e entram na da nova
+ */
+int ppos_set_scheduler(int policy) {
+    sched_class_t* cls = sched_class_of(policy);
+
+    if (!cls) {
+        return -1;
+    }
+
+    PPOS_PREEMPT_DISABLE;
+
+    task_t* current = readyQueue;
+    if (cpu_class && current) {
         do {
-            // Aplica aging nas tarefas não-escolhidas
-            if (current != better) {
-                if (current->prio_dynamic MENOS_PRIO PRIORITY_MAX) {
-                    current->prio_dynamic += PRIORITY_ALPHA; // Melhora prioridade
-                }
-                // Limita ao valor máximo de prioridade
-                if (current->prio_dynamic MAIS_PRIO PRIORITY_MAX) {
-                    current->prio_dynamic = PRIORITY_MAX;
-                }
+            if (!is_core_task(current)) {
+                rq_dequeue(current);
             }
             current = current->next;
-        }
-        while (current != readyQueue);
+        } while (current != readyQueue);
+    }
 
-        // Reset: tarefa escolhida volta à prioridade original
-        better->prio_dynamic = better->prio_static;
+    cpu_policy = policy;
+    cpu_class  = cls;
+    cpu_class->init();
+    rq_nr_ready = 0;
+
+    current = readyQueue;
+    if (current) {
+        do {
+            if (!is_core_task(current)) {
+                rq_enqueue(current);
+            }
+            current = current->next;
+        } while (current != readyQueue);
     }
 
     PPOS_PREEMPT_ENABLE;
-    return better;
+    return 0;
+}
+
+int ppos_get_scheduler() {
+    return cpu_policy;
 }
 
 /**
@@ -140,13 +1038,23 @@ void task_setprio(task_t *task, int prio) {
     if (task == NULL) {
         task = taskExec;
     }
-    
+
     // Clamp nos limites válidos
     if (prio MAIS_PRIO PRIORITY_MAX)  prio = PRIORITY_MAX;
     if (prio MENOS_PRIO PRIORITY_MIN) prio = PRIORITY_MIN;
-    
+
+    // Tarefa pronta é reposicionada na fila de prontas
+    int ready = !is_core_task(task) && task->rq_node.prev;
+    if (ready) {
+        rq_dequeue(task);
+    }
+
     task->prio_static  = prio;
     task->prio_dynamic = prio;
+
+    if (ready) {
+        rq_enqueue(task);
+    }
 }
 
 int task_getprio(task_t *task) {
@@ -157,6 +1065,142 @@ int task_getprio(task_t *task) {
     return task->prio_static;
 }
 
+void task_setshare(task_t *task, int tickets) {
+    if (task == NULL) {
+        task = taskExec;
+    }
+    if (is_core_task(task)) {
+        return;
+    }
+
+    // Fora dos limites volta a derivar os tickets da prioridade
+    if (tickets < 0 || tickets > TICKETS_MAX) {
+        tickets = 0;
+    }
+
+    // O avanço por tick muda a ordem no heap: a tarefa pronta é reinserida
+    int ready = task->rq_node.prev != NULL;
+    if (ready) {
+        rq_dequeue(task);
+    }
+
+    task->tickets = tickets;
+    task->stride  = STRIDE1 / stride_tickets(task);
+
+    if (ready) {
+        rq_enqueue(task);
+    }
+}
+
+int task_getshare(task_t *task) {
+    if (task == NULL) {
+        task = taskExec;
+    }
+
+    return is_core_task(task) ? 0 : stride_tickets(task);
+}
+
+void task_set_eet(task_t *task, int et) {
+    if (task == NULL) {
+        task = taskExec;
+    }
+    if (is_core_task(task)) {
+        return;
+    }
+    if (et < 0) {
+        et = 0;
+    }
+
+    // O tempo restante é chave do SRTF: a tarefa pronta é reinserida
+    int ready = task->rq_node.prev != NULL;
+    if (ready) {
+        rq_dequeue(task);
+    }
+
+    task->eet            = et;
+    task->remaining_time = (et > (int)task->running_time) ? et - (int)task->running_time : 0;
+
+    if (ready) {
+        rq_enqueue(task);
+        rq_check_preempt(task);
+    }
+}
+
+int task_get_eet(task_t *task) {
+    if (task == NULL) {
+        task = taskExec;
+    }
+
+    return is_core_task(task) ? 0 : task->eet;
+}
+
+int task_get_ret(task_t *task) {
+    if (task == NULL) {
+        task = taskExec;
+    }
+
+    return is_core_task(task) ? 0 : task->remaining_time;
+}
+
+int task_set_period(task_t *task, int period, int budget) {
+    if (task == NULL) {
+        task = taskExec;
+    }
+    if (is_core_task(task) || period < 0 || (period > 0 && (budget <= 0 || budget > period))) {
+        return -1;
+    }
+
+    // Admissão: a utilização total não pode passar de 1
+    unsigned long old_load = edf_task_load(task->budget, task->period);
+    unsigned long new_load = edf_task_load(budget, period);
+    if (edf_load - old_load + new_load > EDF_LOAD_MAX) {
+        return -1;
+    }
+    edf_load = edf_load - old_load + new_load;
+
+    // O prazo é chave do EDF: a tarefa pronta é reinserida
+    int ready = task->rq_node.prev != NULL;
+    if (ready) {
+        rq_dequeue(task);
+    }
+
+    task->period      = period;
+    task->budget      = budget;
+    task->budget_left = budget;
+    task->release     = systime();
+    task->deadline    = period ? task->release + period : DEADLINE_NONE;
+    task->job_active  = period ? 1 : 0;
+
+    if (ready) {
+        rq_enqueue(task);
+        rq_check_preempt(task);
+    }
+
+    return 0;
+}
+
+void task_set_deadline(task_t *task, int deadline) {
+    if (task == NULL) {
+        task = taskExec;
+    }
+    if (is_core_task(task)) {
+        return;
+    }
+
+    // O prazo é chave do EDF: a tarefa pronta é reinserida
+    int ready = task->rq_node.prev != NULL;
+    if (ready) {
+        rq_dequeue(task);
+    }
+
+    task->deadline = (deadline < 0) ? DEADLINE_NONE : systime() + (unsigned int)deadline;
+
+    if (ready) {
+        rq_enqueue(task);
+        rq_check_preempt(task);
+    }
+}
+
 /**
  * ============================================================================
  * SISTEMA DE PREEMPÇÃO POR TEMPO
@@ -175,14 +1219,25 @@ void interrupt_handler(int signum) {
     #endif
 
     // Controle de quantum apenas para tarefas de usuário
-    if (!taskExec->user_task) {
+    if (!is_user_task(taskExec)) {
         return;
     }
 
+    // Tempo de execução e contabilização da classe de escalonamento
+    taskExec->running_time++;
+    cpu_class->tick(taskExec);
+
     taskExec->quantum--;
 
-    // Preempção por esgotamento de quantum
-    if (taskExec->quantum <= 0 && PPOS_IS_PREEMPT_ACTIVE) { 
+    // Preempção por esgotamento de quantum ou por tarefa que acordou
+    if ((taskExec->quantum <= 0 || rq_need_resched) && PPOS_IS_PREEMPT_ACTIVE) { 
+#ifdef PPOS_FAST_SWITCH
+        // A troca rápida não restaura máscaras de sinais: SIGALRM, bloqueado
+        // durante o handler, seria herdado pela próxima tarefa. Os ticks que
+        // chegarem antes da troca não preemptam (preempção desabilitada)
+        PPOS_PREEMPT_DISABLE;
+        sigprocmask(SIG_UNBLOCK, &timer_mask, NULL);
+#endif
         task_yield();
     }
 }
@@ -200,6 +1255,10 @@ void timer_init() {
         perror("Erro em sigaction: ");
         exit(1);
     }
+#ifdef PPOS_FAST_SWITCH
+    sigemptyset(&timer_mask);
+    sigaddset(&timer_mask, SIGALRM);
+#endif
     
     // Timer periódico de 1ms
     timer.it_value.tv_usec    = TIMER_INTERVAL;
@@ -213,6 +1272,349 @@ void timer_init() {
     }
 }
 
+/**
+ * ============================================================================
+ * PILHAS DAS TAREFAS
+ * ============================================================================
+ *
+ * O task_create do núcleo aloca cada pilha com malloc(STACKSIZE) e o
+ * dispatcher a libera ao recolher a freeTask; esse continua sendo o padrão.
+ * Com o pool (ligado por ppos_set_stack_pool), as pilhas são mapeadas com
+ * mmap, agrupadas em classes de tamanho e reaproveitadas: uma tarefa que
+ * encerra deixa a pilha numa lista de mortas (after_task_exit, ainda
+ * executando sobre ela), e o dispatcher a devolve à classe na próxima
+ * decisão, quando ninguém mais a usa. Opcionalmente cada pilha nova tem uma
+ * página de guarda sem acesso logo abaixo (estouro vira SIGSEGV) e tem suas
+ * páginas tocadas na criação (sem faltas de página durante a execução).
+ *
+ * O núcleo é ligado com task_create fraco (ppos-all-weak.o, gerado pelo
+ * Makefile com objcopy); o dispatcher, de TCB sem campos estendidos, mantém
+ * a pilha do malloc.
+ */
+
+// Pilha livre ou morta: cabeçalho gravado na base da própria pilha
+typedef struct stack_node_t
+{
+   struct stack_node_t *next ;
+   void   *map ;       // início do mapeamento (página de guarda incluída)
+   size_t  maplen ;
+   int     class ;     // classe no pool (STACK_POOL_CLASSES = fora do pool)
+} stack_node_t ;
+
+static int stack_flags = 0;                             // Padrão: malloc/free, como no núcleo
+static size_t stack_page;                               // Tamanho da página
+static stack_node_t* stack_free[STACK_POOL_CLASSES];    // Pilhas livres por classe
+static unsigned int stack_nfree[STACK_POOL_CLASSES];
+static stack_node_t* stack_dead;                        // Aguardando o dispatcher
+
+// Menor classe que comporta size bytes (STACK_POOL_CLASSES se nenhuma)
+static int stack_class_of(size_t size) {
+    int c = 0;
+
+    while (c < STACK_POOL_CLASSES && ((size_t)STACK_POOL_MIN << c) < size) {
+        c++;
+    }
+    return c;
+}
+
+/**
+ * Reserva a pilha da tarefa: do malloc (pool desligado, dispatcher) ou de
+ * uma classe do pool, mapeando uma nova se a classe estiver vazia.
+ * Preenche uc_stack e task->stack_class; retorna 0 ou -1
+ */
+static int stack_alloc(task_t* task, size_t size, int core) {
+    stack_node_t* node;
+    void* map;
+    size_t guard, maplen;
+    int c;
+
+    if (core || !(stack_flags & STACK_POOL)) {
+        task->context.uc_stack.ss_sp   = malloc(size);
+        task->context.uc_stack.ss_size = size;
+        if (!core) {
+            task->stack_class = STACK_MALLOC;
+        }
+        return task->context.uc_stack.ss_sp ? 0 : -1;
+    }
+
+    c = stack_class_of(size);
+    if (c < STACK_POOL_CLASSES) {
+        size = (size_t)STACK_POOL_MIN << c;
+        if ((node = stack_free[c])) {
+            stack_free[c] = node->next;
+            stack_nfree[c]--;
+            task->context.uc_stack.ss_sp   = node;
+            task->context.uc_stack.ss_size = size;
+            task->stack_class = c;
+            return 0;
+        }
+    }
+    else {
+        size = (size + stack_page - 1) & ~(stack_page - 1);
+    }
+
+    guard  = (stack_flags & STACK_POOL_GUARD) ? stack_page : 0;
+    maplen = size + guard;
+    map = mmap(NULL, maplen, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+    if (guard && mprotect(map, guard, PROT_NONE) < 0) {
+        munmap(map, maplen);
+        return -1;
+    }
+
+    // Pré-falta: uma escrita por página, do topo (usado primeiro) à base
+    if (stack_flags & STACK_POOL_PREFAULT) {
+        char* page;
+        for (page = (char*)map + maplen - stack_page; page >= (char*)map + guard; page -= stack_page) {
+            *(volatile char*)page = 0;
+        }
+    }
+
+    node = (stack_node_t*)((char*)map + guard);
+    node->map    = map;
+    node->maplen = maplen;
+    node->class  = c;
+
+    task->context.uc_stack.ss_sp   = node;
+    task->context.uc_stack.ss_size = size;
+    task->stack_class = c;
+    return 0;
+}
+
+/**
+ * Tarefa encerrando (ainda sobre a própria pilha): a pilha vai para a lista
+ * de mortas e o ss_sp é zerado, para que o free do dispatcher não a toque.
+ * O cabeçalho gravado na base fica longe do topo, onde a tarefa executa
+ */
+static void stack_retire(task_t* task) {
+    stack_node_t* node = task->context.uc_stack.ss_sp;
+
+    if (task->stack_class == STACK_MALLOC || !node) {
+        return;
+    }
+
+    node->next = stack_dead;
+    stack_dead = node;
+    task->context.uc_stack.ss_sp = NULL;
+}
+
+/**
+ * Devolve ao pool as pilhas mortas; chamada pelo dispatcher (e na criação
+ * de tarefas), quando nenhuma delas está mais em uso
+ */
+static void stack_reap(void) {
+    stack_node_t* node;
+    int c;
+
+    while ((node = stack_dead)) {
+        stack_dead = node->next;
+        c = node->class;
+
+        if (c < STACK_POOL_CLASSES && stack_nfree[c] < STACK_POOL_KEEP) {
+            node->next = stack_free[c];
+            stack_free[c] = node;
+            stack_nfree[c]++;
+        }
+        else {
+            munmap(node->map, node->maplen);
+        }
+    }
+}
+
+/**
+ * Mesma sequência do task_create do núcleo, com a pilha do pool e sem o
+ * malloc(0) do custom_data (o free do task_exit aceita NULL). A preempção
+ * fica desabilitada de before_task_create a after_task_create
+ */
+int task_create_ex(task_t *task, void (*start_func)(void *), void *arg, size_t stacksize) {
+    int core = (nextid <= 1);   // Dispatcher: TCB do núcleo
+
+    before_task_create(task);
+
+    getcontext(&task->context);
+
+    stack_reap();
+    if (stack_alloc(task, stacksize ? stacksize : STACKSIZE, core) < 0) {
+        perror("Erro na criação da pilha: ");
+        PPOS_PREEMPT_ENABLE;
+        return -1;
+    }
+    task->context.uc_stack.ss_flags = 0;
+    task->context.uc_link = 0;
+    makecontext(&task->context, (void (*)(void))start_func, 1, arg);
+
+    task->id = nextid++;
+    countTasks++;
+
+    task->joinQueue   = NULL;
+    task->awakeTime   = 0;
+    task->custom_data = NULL;
+
+    queue_append((queue_t**)&readyQueue, (queue_t*)task);
+    task->queue = (task_t*)&readyQueue;
+    task->state = 'r';          // Estados do núcleo: minúsculas (ver task_t)
+
+    after_task_create(task);
+
+    return task->id;
+}
+
+int task_create(task_t *task, void (*start_func)(void *), void *arg) {
+    return task_create_ex(task, start_func, arg, 0);
+}
+
+/**
+ * Configura a alocação das pilhas criadas a partir de agora (STACK_POOL_*);
+ * pilhas já no pool continuam sendo reaproveitadas
+ */
+void ppos_set_stack_pool(int flags) {
+    stack_flags = flags;
+}
+
+int ppos_get_stack_pool() {
+    return stack_flags;
+}
+
+/**
+ * ============================================================================
+ * TROCA DE CONTEXTO RÁPIDA (x86-64, -DPPOS_FAST_SWITCH)
+ * ============================================================================
+ *
+ * Substitui o task_switch do núcleo, cujo swapcontext salva o ucontext_t
+ * inteiro e faz uma chamada rt_sigprocmask a cada troca. Aqui só são salvos
+ * os registradores preservados entre chamadas (rbx, rbp, r12-r15, controle
+ * de MXCSR e x87), na pilha da própria tarefa, e o SP; a máscara de sinais
+ * só é tratada na preempção (interrupt_handler).
+ *
+ * O núcleo é ligado com task_switch fraco (ppos-all-weak.o, gerado pelo
+ * Makefile com objcopy), de modo que suas chamadas internas chegam aqui.
+ * Main e dispatcher têm TCB alocada no núcleo, sem campos estendidos: o SP
+ * salvo fica no uc_mcontext do próprio ucontext_t, e RIP zerado marca um
+ * contexto salvo por esta troca. Um contexto recém-criado por makecontext
+ * (RIP não nulo) é ativado uma única vez com setcontext.
+ */
+
+#ifdef PPOS_FAST_SWITCH
+
+#ifndef __x86_64__
+#error "PPOS_FAST_SWITCH só está disponível para x86-64"
+#endif
+
+// Registradores do uc_mcontext: sem _GNU_SOURCE a glibc os chama de __gregs
+// e não define os índices REG_*
+#ifdef __USE_MISC
+#define CTX_GREGS(task) ((task)->context.uc_mcontext.gregs)
+#else
+#define CTX_GREGS(task) ((task)->context.uc_mcontext.__gregs)
+#endif
+#define CTX_GREG_RSP    15
+#define CTX_GREG_RIP    16
+
+#define CTX_SP(task)    (CTX_GREGS(task)[CTX_GREG_RSP])
+#define CTX_PC(task)    (CTX_GREGS(task)[CTX_GREG_RIP])
+
+// Valores iniciais de MXCSR e da palavra de controle x87 (ABI System V)
+#define CTX_MXCSR_INIT  0x1f80
+#define CTX_FPUCW_INIT  0x037f
+
+// Salva o contexto atual em *save_sp e retoma o de load_sp
+void ppos_ctx_switch(greg_t* save_sp, greg_t load_sp);
+// Primeira ativação de uma tarefa: rbx traz a TCB
+void ppos_ctx_start(void);
+
+__asm__ (
+    ".text\n"
+    ".globl ppos_ctx_switch\n"
+    ".type ppos_ctx_switch, @function\n"
+    ".p2align 4\n"
+    "ppos_ctx_switch:\n"
+    "    pushq   %rbp\n"
+    "    pushq   %rbx\n"
+    "    pushq   %r12\n"
+    "    pushq   %r13\n"
+    "    pushq   %r14\n"
+    "    pushq   %r15\n"
+    "    subq    $8, %rsp\n"
+    "    stmxcsr (%rsp)\n"
+    "    fnstcw  4(%rsp)\n"
+    "    movq    %rsp, (%rdi)\n"
+    "    movq    %rsi, %rsp\n"
+    "    ldmxcsr (%rsp)\n"
+    "    fldcw   4(%rsp)\n"
+    "    addq    $8, %rsp\n"
+    "    popq    %r15\n"
+    "    popq    %r14\n"
+    "    popq    %r13\n"
+    "    popq    %r12\n"
+    "    popq    %rbx\n"
+    "    popq    %rbp\n"
+    "    ret\n"
+    ".size ppos_ctx_switch, .-ppos_ctx_switch\n"
+    ".globl ppos_ctx_start\n"
+    ".type ppos_ctx_start, @function\n"
+    ".p2align 4\n"
+    "ppos_ctx_start:\n"
+    "    movq    %rbx, %rdi\n"
+    "    call    ppos_ctx_enter\n"
+    "    ud2\n"
+    ".size ppos_ctx_start, .-ppos_ctx_start\n"
+);
+
+// Carrega o contexto criado por makecontext (máscara de sinais incluída)
+void ppos_ctx_enter(task_t* task) {
+    setcontext(&task->context);
+    perror("Erro em setcontext: ");
+    exit(1);
+}
+
+/**
+ * Monta, abaixo do quadro deixado por makecontext, um quadro igual ao que
+ * ppos_ctx_switch salva, cujo retorno leva a ppos_ctx_start; retorna seu SP.
+ * O ucontext_t fica intacto para o setcontext
+ */
+static greg_t ctx_prepare(task_t* task) {
+    uint64_t* frame = (uint64_t*)(((uintptr_t)CTX_SP(task) - 128) & ~(uintptr_t)15);
+
+    frame[0] = CTX_MXCSR_INIT | ((uint64_t)CTX_FPUCW_INIT << 32);
+    frame[1] = 0;                            // r15
+    frame[2] = 0;                            // r14
+    frame[3] = 0;                            // r13
+    frame[4] = 0;                            // r12
+    frame[5] = (uint64_t)(uintptr_t)task;    // rbx
+    frame[6] = 0;                            // rbp
+    frame[7] = (uint64_t)(uintptr_t)ppos_ctx_start;
+
+    return (greg_t)(uintptr_t)frame;
+}
+
+/**
+ * Mesma sequência do task_switch do núcleo (hooks, taskExec), trocando
+ * swapcontext por ppos_ctx_switch
+ */
+int task_switch(task_t *task) {
+    before_task_switch(task);
+
+    unsigned char saved = preemption;
+    PPOS_PREEMPT_DISABLE;
+    task_t* prev = taskExec;
+    taskExec = task;
+    preemption = saved;
+
+    after_task_switch(task);
+
+    if (prev != task) {
+        greg_t load_sp = CTX_PC(task) ? ctx_prepare(task) : CTX_SP(task);
+        CTX_PC(prev) = 0;
+        ppos_ctx_switch(&CTX_SP(prev), load_sp);
+    }
+
+    return 0;
+}
+
+#endif
+
 /**
  * ============================================================================
  * HOOKS DO SISTEMA
@@ -223,6 +1625,9 @@ void before_ppos_init () {
 #ifdef DEBUG
     printf("\ninit - BEFORE");
 #endif    
+
+    rq_init();
+    stack_page = sysconf(_SC_PAGESIZE);
 }
 
 /**
@@ -236,8 +1641,11 @@ void after_ppos_init () {
     _systemTime = 0;
     timer_init();
 
-    // Main é tarefa de sistema (não sofre preempção por quantum)
-    taskMain->user_task = 0;
+    // Main é tarefa de sistema (não sofre preempção por quantum); sua TCB
+    // não tem os campos estendidos, ver is_user_task()
+
+    // Main foi inserida na readyQueue pelo núcleo sem passar por hook
+    rq_enqueue(taskMain);
 
     PPOS_PREEMPT_ENABLE;
 }
@@ -265,13 +1673,19 @@ void after_task_create (task_t *task ) {
     printf("\ntask_create - AFTER - [%d]", task->id);
 #endif
 
+    // O dispatcher (id 1) não tem os campos estendidos da task_t
+    if (is_core_task(task)) {
+        PPOS_PREEMPT_ENABLE;
+        return;
+    }
+
     // Configuração inicial de prioridades e quantum
     task->prio_static  = PRIORITY_DEF;
     task->prio_dynamic = PRIORITY_DEF;
     task->quantum      = QUANTUM_SIZE;
 
     // Classificação: id > 1 = usuário, id <= 1 = sistema
-    task->user_task    = (task->id > 1) ? 1 : 0;
+    task->user_task    = 1;
 
     // Inicialização das métricas de contabilização
     task->exec_start   = systime();     
@@ -279,8 +1693,32 @@ void after_task_create (task_t *task ) {
     task->last_proc    = 0;            
     task->activations  = 0;             
     task->running_time = 0;             
+
+    // Campos das classes de escalonamento: sem estimativa, sem prazo
+    task->eet            = EET_UNKNOWN;
+    task->remaining_time = EET_UNKNOWN;
+    task->tickets        = 0;
+    task->stride         = STRIDE1 / stride_tickets(task);
+    task->pass           = 0;
+    task->deadline       = DEADLINE_NONE;
+    task->period         = 0;
+    task->budget         = 0;
+    task->budget_left    = 0;
+    task->release        = 0;
+    task->job_active     = 0;
+    task->deadline_misses = 0;
+    task->budget_overruns = 0;
+    task->mlfq_level     = 0;
+    task->mlfq_used      = 0;
+    task->mlfq_epoch     = mlfq_epoch;
+
+    // O núcleo já a inseriu na readyQueue
+    task->rq_node.prev = NULL;
+    rq_enqueue(task);
     
     PPOS_PREEMPT_ENABLE;
+
+    rq_check_preempt(task);
 }
 
 void before_task_exit () {
@@ -290,8 +1728,19 @@ void before_task_exit () {
 
     PPOS_PREEMPT_DISABLE;
 
+    // Tarefa periódica: encerra o job e libera sua utilização
+    if (is_user_task(taskExec) && taskExec->period) {
+        edf_job_end(taskExec);
+        edf_load -= edf_task_load(taskExec->budget, taskExec->period);
+        taskExec->period = 0;
+    }
 }
 
+// Ganchos do gerente de disco (ppos_disk.c): fracos, para que os programas
+// sem disco (Projeto A) liguem sem ele; ficam nulos nesse caso
+extern void disk_task_exit(task_t* task) __attribute__((weak));
+extern void disk_mgr_shutdown() __attribute__((weak));
+
 /**
  * Calcula e exibe estatísticas finais da tarefa
  */
@@ -300,6 +1749,10 @@ void after_task_exit () {
     printf("\ntask_exit - AFTER- [%d]", taskExec->id);
 #endif
 
+    // O núcleo reabilita a preempção antes de trocar para o dispatcher: uma
+    // preempção aqui recolocaria a tarefa na fila com a pilha já devolvida
+    PPOS_PREEMPT_DISABLE;
+
     unsigned int task_total_time = systime() - taskExec->exec_start;
 
     printf("Task %d exit: execution time %u ms, processor time %u ms, %u activations\n",
@@ -308,11 +1761,19 @@ void after_task_exit () {
         taskExec->proc_time,    
         taskExec->activations);
 
+    // E/S da tarefa no disco, se houve (ppos_disk.c)
+    if (disk_task_exit) {
+        disk_task_exit(taskExec);
+    }
+
 //Se a main (task 0) terminou, sinaliza disk manager para encerrar
-    if (taskExec->id == 0) {
-        extern void disk_mgr_shutdown();  // Declara função do ppos_disk.c
+    if (taskExec->id == 0 && disk_mgr_shutdown) {
         disk_mgr_shutdown();
     }
+
+    if (!is_core_task(taskExec)) {
+        stack_retire(taskExec);
+    }
 }
 
 /**
@@ -326,7 +1787,7 @@ void before_task_switch ( task_t *task ) {
     PPOS_PREEMPT_DISABLE;
 
     // Atualiza tempo de processador da tarefa atual
-    if (taskExec && taskExec->user_task && taskExec->last_proc > 0) {
+    if (taskExec && is_user_task(taskExec) && taskExec->last_proc > 0) {
         unsigned int time_slice = systime() - taskExec->last_proc;
         taskExec->proc_time += time_slice;
     }
@@ -340,10 +1801,13 @@ void after_task_switch ( task_t *task ) {
     printf("\ntask_switch - AFTER - [%d -> %d]", taskExec->id, task->id);
 #endif
 
-    if (task && task->user_task) {
+    rq_need_resched = 0;
+
+    if (task && is_user_task(task)) {
         task->activations++;
         task->last_proc = systime();
-        task->quantum   = QUANTUM_SIZE;     // Quantum completo para nova tarefa
+        // Quantum completo para nova tarefa (ou o definido pela classe)
+        task->quantum   = cpu_class->slice ? cpu_class->slice(task) : QUANTUM_SIZE;
     }
 
     PPOS_PREEMPT_ENABLE;
@@ -362,6 +1826,10 @@ void after_task_yield () {
 #ifdef DEBUG02
     printf("\ntask_yield - AFTER - [%d]", taskExec->id);
 #endif
+
+    if (IN_READY_QUEUE(taskExec)) {
+        rq_enqueue(taskExec);
+    }
     // Preempção reabilitada em after_task_switch
 }
 
@@ -379,6 +1847,11 @@ void after_task_suspend( task_t *task ) {
     printf("\ntask_suspend - AFTER - [%d]", task->id);
 #endif
 
+    // Tarefa pronta retirada da readyQueue pelo núcleo
+    if (!IN_READY_QUEUE(task)) {
+        rq_dequeue(task);
+    }
+
     PPOS_PREEMPT_ENABLE;
 }
 
@@ -395,6 +1868,11 @@ void after_task_resume(task_t *task) {
     printf("\ntask_resume - AFTER - [%d]", task->id);
 #endif
 
+    if (IN_READY_QUEUE(task)) {
+        rq_enqueue(task);
+        rq_defer_preempt(task);
+    }
+
     PPOS_PREEMPT_ENABLE;
 }
 
@@ -404,6 +1882,11 @@ void before_task_sleep () {
 #endif
 
     PPOS_PREEMPT_DISABLE;    
+
+    // Tarefa periódica dormindo: fim do job deste período
+    if (cpu_class == &edf_class && is_user_task(taskExec)) {
+        edf_job_end(taskExec);
+    }
 }
 
 void after_task_sleep () {
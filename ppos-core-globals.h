@@ -11,9 +11,9 @@ extern task_t* sleepQueue; // Ponteiro para a fila de tarefas dormindo
 //extern task_t* taskDiskMgr; // Ponterio para a tarefa gerente do disco
 extern long nextid;        // Valor do proximo ID a ser usado pelo task_create()
 extern long countTasks;    // Total de tarefas de usuario
-extern unsigned char preemption; // indica se pode haver preempcao no momento. 
+extern volatile unsigned char preemption; // indica se pode haver preempcao no momento. 
                                 // Valor 1 indica que a preempcao esta habilido, 
                                 // qualquer outro valor indica desabilitado
-extern unsigned int _systemTime; // armazena o tempo global do sistema, em ticks do relogio
+extern volatile unsigned int _systemTime; // armazena o tempo global do sistema, em ticks do relogio
 
 #endif
\ No newline at end of file
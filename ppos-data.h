@@ -11,6 +11,14 @@
 #include <ucontext.h>		// biblioteca POSIX de trocas de contexto
 #include "queue.h"		// biblioteca de filas genéricas
 
+// Nó de heap intrusivo (pairing heap) usado pela fila de prontas do escalonador
+typedef struct rqnode_t
+{
+   struct rqnode_t *child ;	// primeiro filho
+   struct rqnode_t *sibling ;	// próximo irmão
+   struct rqnode_t *prev ;	// pai (se primeiro filho) ou irmão anterior
+} rqnode_t ;
+
 // Estrutura que define um Task Control Block (TCB)
 typedef struct task_t
 {
@@ -30,20 +38,51 @@ typedef struct task_t
 
     // Prioridades para escalonamento
    int prio_static;           // Prioridade estática da tarefa (-20 a +20)
-   int prio_dynamic;          // Prioridade dinâmica (usada pelo escalonador)
+   int prio_dynamic;          // Prioridade dinâmica (na fila de prontas: valor ao entrar)
    
    // Controle de preempção
-   int quantum;               // Quantum de tempo restante (em ticks)
+   volatile int quantum;      // Quantum de tempo restante (em ticks)
    
    // Métricas de contabilização
    unsigned int exec_start;   // Timestamp de quando a tarefa foi criada
    unsigned int proc_time;    // Tempo total de uso do processador (em ms)
    unsigned int last_proc;    // Timestamp da última vez que ganhou o processador
    unsigned int activations;  // Número de vezes que foi ativada
-   unsigned int running_time; // Tempo de execução acumulado (em ticks)
+   volatile unsigned int running_time; // Tempo de execução acumulado (em ticks)
 
    unsigned int user_task;    // Indica se é uma tarefa do sistema (0) ou de usuário 
 
+   // Shortest Remaining Time First
+   int eet;                   // Tempo estimado de execução (em ticks)
+   int remaining_time;        // Tempo de execução restante estimado (em ticks)
+
+   // Stride scheduling
+   int tickets;               // Tickets (0 = derivados da prioridade estática)
+   unsigned int stride;       // Avanço do passo por tick (STRIDE1 / tickets)
+   unsigned long long pass;   // Passo: CPU consumida ponderada pelos tickets
+
+   // Earliest Deadline First
+   unsigned int deadline;     // Prazo absoluto (em ms)
+   unsigned int period;       // Período (em ms, 0 = aperiódica)
+   unsigned int budget;       // Orçamento de processador por período (em ticks)
+   int budget_left;           // Orçamento restante no job corrente
+   unsigned int release;      // Início do período do job corrente
+   unsigned int job_active;   // Job do período corrente ainda não terminou
+   unsigned int deadline_misses;  // Jobs terminados após o prazo
+   unsigned int budget_overruns;  // Jobs que esgotaram o orçamento
+
+   // Filas multinível com realimentação
+   unsigned int mlfq_level;   // Nível (0 = mais prioritário)
+   unsigned int mlfq_used;    // Ticks consumidos no nível
+   unsigned int mlfq_epoch;   // Época de boost em que o nível foi gravado
+
+   // Pilha
+   int stack_class;           // Classe no pool de pilhas (-1 = malloc, liberada pelo núcleo)
+
+   // Fila de prontas indexada por prioridade
+   rqnode_t rq_node;          // Nó no heap do nível de prioridade (prev NULL = fora)
+   unsigned int ready_epoch;  // Ao entrar na fila: época (prioridades) ou ordem de chegada (RR, EDF, MLFQ)
+
 } task_t ;
 
 // estrutura que define um semáforo
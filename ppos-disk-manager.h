@@ -7,6 +7,9 @@
 #ifndef __DISK_MGR__
 #define __DISK_MGR__
 
+#include <signal.h>
+#include <sys/uio.h>
+
 //#define DEBUG_DISK 1
 
 // estruturas de dados e rotinas de inicializacao e acesso
@@ -22,6 +25,32 @@ typedef struct diskrequest_t {
     unsigned char operation; // DISK_REQUEST_READ ou DISK_REQUEST_WRITE
     int block;
     void* buffer;
+
+    semaphore_t done;        // a tarefa dona espera aqui pela conclusão
+    int status;              // resultado da operação (0 ou -1)
+    unsigned char finished;  // já concluída (disk_poll, disk_wait_any)
+
+    int count;               // blocos consecutivos a partir de block
+    const struct iovec* iov; // buffers dos blocos, em ordem
+    int iovcnt;
+    size_t offset;           // início dos blocos em iov, em bytes
+    struct iovec one;        // iov das operações de um bloco
+    struct diskrequest_t* merged;  // próxima atendida na mesma operação
+
+    struct diskrequest_t* left;    // índice das pendentes por bloco (treap)
+    struct diskrequest_t* right;
+    unsigned int seq;        // ordem de chegada, desempata o índice
+
+    unsigned int arrival;    // systime() ao entrar na fila
+    unsigned int deadline;   // prazo para ser atendida (política DEADLINE)
+    struct diskrequest_t* expireNext;  // lista de prazos da sua operação
+    struct diskrequest_t* expirePrev;
+
+    struct disk_flow_t* flow;          // fila da tarefa dona (política FAIR)
+    struct diskrequest_t* flowNext;    // pendentes da mesma fila, por chegada
+    struct diskrequest_t* flowPrev;
+
+    struct disk_device_t* device;      // disco da requisição
 } diskrequest_t;
 
 // estrutura que representa um disco no sistema operacional
@@ -32,12 +61,16 @@ typedef struct {
 
     semaphore_t semaforo;
 
-    unsigned char sinal;
+    volatile sig_atomic_t sinal;  // escrito pelo tratador de SIGUSR1
     unsigned char livre;
 
-    task_t* diskQueue;
+    diskrequest_t* current;       // requisição em andamento no disco
     semaphore_t semaforo_queue;
-    diskrequest_t* requestQueue;
+    diskrequest_t* requestQueue;  // pendentes em ordem de chegada
+    diskrequest_t* requestIndex;  // as mesmas, ordenadas por bloco
+    unsigned int requestSeq;      // próxima ordem de chegada
+    diskrequest_t* expireHead[2]; // pendentes de leitura e de escrita, por prazo
+    diskrequest_t* expireTail[2];
 } disk_t;
 
 
@@ -54,7 +87,203 @@ int disk_block_read (int block, void *buffer) ;
 // escrita de um bloco, do buffer para o disco
 int disk_block_write (int block, void *buffer) ;
 
+// leitura/escrita de count blocos a partir de block, espalhados nos
+// buffers de iov (que somam count * blockSize bytes), em operações de
+// até DISK_MERGE_MAX blocos
+int disk_block_readv (int block, int count, const struct iovec *iov, int iovcnt) ;
+int disk_block_writev (int block, int count, const struct iovec *iov, int iovcnt) ;
+
+// E/S assíncrona: enfileira a leitura/escrita de um bloco sem suspender a
+// tarefa e retorna um descritor (NULL em erro); o buffer deve continuar
+// válido até a conclusão. Pendentes ao mesmo tempo no mesmo bloco não têm
+// ordem garantida entre si. Com todas as DISK_REQUEST_POOL vagas ocupadas,
+// espera uma ser liberada (não deixe mais que isso sem coletar)
+diskrequest_t* disk_submit_read (int block, void *buffer) ;
+diskrequest_t* disk_submit_write (int block, void *buffer) ;
+
+// vários discos: cada um com a sua imagem, fila, política, cache e tarefa
+// gerenciadora. O disco 0 é o do disk_mgr_init (disk.dat); os demais só
+// com o disco mapeado em memória (make DISK_DRIVER=mmap). As funções sem
+// _dev usam o disco 0; as _dev recebem o número do disco
+#ifndef DISK_MAX_DEVICES
+#define DISK_MAX_DEVICES 16
+#endif
+
+// inicializa mais um disco, com a imagem dada; retorna o seu número ou -1
+int disk_dev_init (const char *image, int *numBlocks, int *blockSize) ;
+
+// disco em faixas (RAID-0) sobre count discos já inicializados: faixas de
+// chunk blocos seguidos, uma em cada membro, em rodízio; retorna o número
+// do novo disco ou -1. Blocos em membros diferentes são atendidos em
+// paralelo, e um readv/writev é dividido entre os membros
+int disk_stripe_init (const int *members, int count, int chunk,
+                      int *numBlocks, int *blockSize) ;
+
+int disk_block_read_dev (int dev, int block, void *buffer) ;
+int disk_block_write_dev (int dev, int block, void *buffer) ;
+int disk_block_readv_dev (int dev, int block, int count, const struct iovec *iov, int iovcnt) ;
+int disk_block_writev_dev (int dev, int block, int count, const struct iovec *iov, int iovcnt) ;
+diskrequest_t* disk_submit_read_dev (int dev, int block, void *buffer) ;
+diskrequest_t* disk_submit_write_dev (int dev, int block, void *buffer) ;
+
+// espera a conclusão, libera o descritor e retorna o status (0 ou -1)
+int disk_wait (diskrequest_t *handle) ;
+
+// espera até que um dos n descritores (da tarefa atual, de qualquer disco;
+// NULL é ignorado) esteja concluído e retorna o seu índice, ou -1; colete-o com disk_wait
+int disk_wait_any (diskrequest_t **handles, int n) ;
+
+// retorna 1 se a operação já concluiu, 0 se ainda não, -1 se inválido
+int disk_poll (diskrequest_t *handle) ;
+
+// vagas de requisição reservadas por disco inicializado (0: uma por bloco
+// do disco), num pool de todos os discos; sem vaga, a tarefa que pede uma operação espera
+#ifndef DISK_REQUEST_POOL
+#define DISK_REQUEST_POOL 0
+#endif
+
+// requisições em blocos vizinhos são atendidas juntas, até este tamanho
+#ifndef DISK_MERGE_MAX
+#define DISK_MERGE_MAX 32
+#endif
+
+// leitura antecipada: após DISK_RA_TRIGGER leituras consecutivas de uma
+// tarefa, lê os próximos blocos numa janela de DISK_RA_MIN a DISK_RA_MAX
+#ifndef DISK_RA_MAX
+#define DISK_RA_MAX 32          // 0 desativa a leitura antecipada
+#endif
+#ifndef DISK_RA_MIN
+#define DISK_RA_MIN 4
+#endif
+#ifndef DISK_RA_TRIGGER
+#define DISK_RA_TRIGGER 2
+#endif
+#ifndef DISK_RA_STREAMS
+#define DISK_RA_STREAMS 8       // fluxos sequenciais acompanhados
+#endif
+
 // escalonador de requisições do disco
 diskrequest_t* disk_scheduler();
 
+// inserção/remoção na fila de requisições (e no índice por bloco)
+void disk_enqueue (diskrequest_t *request) ;
+void disk_dequeue (diskrequest_t *request) ;
+
+// políticas de escalonamento do disco
+#define SCHEDULER_FCFS   1  // First Come, First Served
+#define SCHEDULER_SSTF   2  // Shortest Seek Time First
+#define SCHEDULER_CSCAN  3  // Circular Scan
+#define SCHEDULER_SCAN   4  // Elevador, inverte na borda do disco
+#define SCHEDULER_LOOK   5  // Elevador, inverte na última requisição
+#define SCHEDULER_CLOOK  6  // Circular, volta da última à primeira requisição
+#define SCHEDULER_DEADLINE 7  // SSTF, mas atende antes as de prazo vencido
+#define SCHEDULER_FAIR   8  // Fila por tarefa, vez ponderada pela prioridade
+
+// prazos da política DEADLINE, em ms após a chegada na fila
+#ifndef DISK_READ_EXPIRE
+#define DISK_READ_EXPIRE  1500
+#endif
+#ifndef DISK_WRITE_EXPIRE
+#define DISK_WRITE_EXPIRE 2500
+#endif
+
+// fatias da política FAIR: a fila da vez é atendida até gastar
+// DISK_FAIR_BUDGET blocos ou DISK_FAIR_SLICE ms (o que vier antes); a
+// próxima é a mais perto da cabeça entre as que receberam até
+// DISK_FAIR_WINDOW blocos (de prioridade 0) a mais que a menos servida
+#ifndef DISK_FAIR_BUDGET
+#define DISK_FAIR_BUDGET 8
+#endif
+#ifndef DISK_FAIR_SLICE
+#define DISK_FAIR_SLICE  100
+#endif
+#ifndef DISK_FAIR_WINDOW
+#define DISK_FAIR_WINDOW 8
+#endif
+
+// tarefas com fila própria em cada disco, numa tabela reservada na
+// inicialização; com ela cheia, as demais usam a fila do sistema
+#ifndef DISK_FLOWS
+#define DISK_FLOWS 64
+#endif
+
+// troca a política de escalonamento do disco; retorna 0 ou -1 se inválida
+int disk_set_scheduler (int policy) ;
+int disk_set_scheduler_dev (int dev, int policy) ;   // num disco em faixas, nos membros
+
+// mostra a E/S feita pela tarefa (chamada em task_exit)
+void disk_task_exit (task_t *task) ;
+
+// cache de blocos do gerente (tamanho e política definidos na compilação)
+#define DISK_CACHE_LRU   1  // Least Recently Used
+#define DISK_CACHE_ARC   2  // Adaptive Replacement Cache
+
+#ifndef DISK_CACHE_BLOCKS
+#define DISK_CACHE_BLOCKS 64               // blocos em cache (0 desativa)
+#endif
+
+#ifndef DISK_CACHE_POLICY
+#define DISK_CACHE_POLICY DISK_CACHE_ARC   // política de substituição
+#endif
+
+// escritas: direto no disco ou só no cache, gravadas depois pelo gerente
+#define DISK_WRITE_THROUGH  1
+#define DISK_WRITE_BACK     2
+
+#ifndef DISK_CACHE_WRITE
+#define DISK_CACHE_WRITE DISK_WRITE_THROUGH  // padrão; troca com disk_set_cache_write
+#endif
+
+// modo de escrita dos discos inicializados depois da chamada (chamar antes
+// de disk_mgr_init/disk_dev_init); retorna 0 ou ERROR_INVALID
+int disk_set_cache_write (int mode) ;
+
+#ifndef DISK_CACHE_DIRTY_MAX
+#define DISK_CACHE_DIRTY_MAX (DISK_CACHE_BLOCKS / 2)  // sujos antes de gravar
+#endif
+
+// espera até que as escritas feitas no cache estejam no disco; retorna 0
+int disk_sync () ;
+int disk_sync_dev (int dev) ;
+
+// métricas do gerente de um disco desde a sua inicialização
+typedef struct {
+    int requests;           // requisições atendidas
+    int operations;         // operações enviadas ao disco
+    int merged;             // requisições atendidas junto com outra
+    int headMovement;       // blocos percorridos pela cabeça
+} diskmetrics_t;
+
+// preenche metrics com as métricas do disco dev; retorna 0 ou -1
+int disk_metrics_dev (int dev, diskmetrics_t *metrics) ;
+
+// trace das operações do disco 0: com o trace ligado, cada chamada a
+// disk_block_read/disk_block_write grava um registro (instante, tarefa,
+// operação, bloco) no arquivo, depois de um cabeçalho; reproduzido pelo
+// pingpong-disk-replay. Com DISK_TRACE_FILE definido na compilação, o
+// trace começa em disk_mgr_init; termina em disk_trace_stop ou quando main
+// encerra o gerente
+#define DISK_TRACE_MAGIC   0x52545050   // "PPTR"
+#define DISK_TRACE_VERSION 1
+
+typedef struct {
+    unsigned int magic;     // DISK_TRACE_MAGIC
+    unsigned int version;   // DISK_TRACE_VERSION
+    int numBlocks;          // disco onde o trace foi capturado
+    int blockSize;
+} disktrace_header_t;
+
+typedef struct {
+    unsigned int time;      // ms desde o início do trace
+    int task;               // id da tarefa que chamou
+    int operation;          // DISK_CMD_READ ou DISK_CMD_WRITE
+    int block;
+} disktrace_record_t;
+
+// começa a gravar o trace em path (sobrescreve); retorna 0 ou -1
+int disk_trace_start (const char *path) ;
+
+// grava os registros pendentes e fecha o trace; retorna 0 ou -1
+int disk_trace_stop () ;
+
 #endif
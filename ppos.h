@@ -19,11 +19,6 @@
 #warning Este codigo foi planejado para ambientes UNIX (LInux, *BSD, MacOS). A compilacao e execucao em outros ambientes e responsabilidade do usuario.
 #endif
 
-// otimizações podem atrapalhar código que manipula contexto
-#ifdef __OPTIMIZE__
-#error "Please do not use optimizations (-O1, -O2, ...)"
-#endif
-
 #include "ppos-data.h"		// estruturas de dados necessárias
 
 // funções gerais ==============================================================
@@ -62,6 +57,21 @@ void before_task_create (task_t *task );
 void after_task_create (task_t *task );  // Após o retorno dessa funcao, a nova tarefa é incluída na
                                          // fila de tarefas prontas.
 
+// Cria uma nova tarefa com pilha de stacksize bytes (0 = STACKSIZE)
+int task_create_ex (task_t *task, void (*start_func)(void *), void *arg,
+                    size_t stacksize) ;
+
+// alocação das pilhas (combináveis; valem para as pilhas criadas depois)
+#define STACK_POOL           0x1  // reaproveita pilhas (mmap) de tarefas encerradas
+#define STACK_POOL_GUARD     0x2  // página sem acesso abaixo de cada pilha
+#define STACK_POOL_PREFAULT  0x4  // páginas da pilha tocadas na criação
+
+// configura a alocação das pilhas (STACK_POOL_*); 0 = malloc/free por tarefa
+void ppos_set_stack_pool (int flags) ;
+
+// retorna a configuração de alocação das pilhas
+int ppos_get_stack_pool () ;
+
 // Termina a tarefa corrente, indicando um valor de status encerramento
 void task_exit (int exitCode) ;
 void before_task_exit ();
@@ -102,6 +112,46 @@ void task_setprio (task_t *task, int prio) ;
 // retorna a prioridade estática de uma tarefa (ou a tarefa atual)
 int task_getprio (task_t *task) ;
 
+// classes de escalonamento da CPU
+#define CPU_SCHED_RR      1   // round-robin (ordem de chegada)
+#define CPU_SCHED_PRIO    2   // prioridades com aging (padrão)
+#define CPU_SCHED_SRTF    3   // menor tempo restante estimado primeiro
+#define CPU_SCHED_STRIDE  4   // stride scheduling (fatia proporcional aos tickets)
+#define CPU_SCHED_EDF     5   // prazo mais próximo primeiro
+#define CPU_SCHED_MLFQ    6   // filas multinível com realimentação
+
+// troca a classe de escalonamento (CPU_SCHED_*); retorna 0 ou -1 se inválida
+int ppos_set_scheduler (int policy) ;
+
+// retorna a classe de escalonamento ativa
+int ppos_get_scheduler () ;
+
+// define os tickets de uma tarefa (ou da tarefa atual) no stride scheduling;
+// 0 volta a derivá-los da prioridade estática
+void task_setshare (task_t *task, int tickets) ;
+
+// retorna os tickets de uma tarefa (ou da tarefa atual)
+int task_getshare (task_t *task) ;
+
+// define o tempo estimado de execução de uma tarefa (ou da tarefa atual), em ms
+void task_set_eet (task_t *task, int et) ;
+
+// retorna o tempo estimado de execução de uma tarefa (ou da tarefa atual)
+int task_get_eet (task_t *task) ;
+
+// retorna o tempo de execução restante estimado de uma tarefa (ou da tarefa atual)
+int task_get_ret (task_t *task) ;
+
+// define o prazo de uma tarefa (ou da tarefa atual), em ms a partir de agora;
+// prazo negativo remove o prazo
+void task_set_deadline (task_t *task, int deadline) ;
+
+// torna uma tarefa (ou a tarefa atual) periódica no EDF: um job a cada
+// period ms, com até budget ms de processador; period 0 a torna aperiódica.
+// Retorna -1 se os parâmetros forem inválidos ou se a utilização total
+// passar de 1 (tarefa não admitida)
+int task_set_period (task_t *task, int period, int budget) ;
+
 // retorna a proxima tarefa a ser executada conforme a politica de escalonamento
 task_t * scheduler() ;
 
@@ -288,8 +338,12 @@ void print_tcb( task_t* task );
 
 #define PRINT_READY_QUEUE      queue_print ("Ready Queue", (queue_t*)readyQueue, (void*)&print_tcb );
 
-#define PPOS_PREEMPT_ENABLE  preemption = 1;
-#define PPOS_PREEMPT_DISABLE preemption = 0;
+// barreira de compilador: com otimização, acessos à memória não podem ser
+// movidos para fora da região em que a preempção está desabilitada
+#define PPOS_BARRIER()       __asm__ __volatile__ ("" ::: "memory")
+
+#define PPOS_PREEMPT_ENABLE  PPOS_BARRIER (); preemption = 1;
+#define PPOS_PREEMPT_DISABLE preemption = 0; PPOS_BARRIER ();
 #define PPOS_IS_PREEMPT_ACTIVE (preemption == 1)
 
 #endif
@@ -6,8 +6,9 @@
  * Alunos: Lucas Giovanni Thuler
  * 
  * Implementa um gerenciador de disco virtual com suporte a diferentes
- * políticas de escalonamento (FCFS, SSTF, CSCAN) e controle de acesso
- * concorrente através de semáforos.
+ * políticas de escalonamento (FCFS, SSTF, CSCAN, SCAN, LOOK, C-LOOK,
+ * DEADLINE, FAIR) e
+ * controle de acesso concorrente através de semáforos.
  * ============================================================================
  */
 
@@ -18,6 +19,9 @@
 #include "disk-driver.h"       // disk_cmd e constantes
 #include "ppos_disk.h"
 #include <limits.h>
+#include <string.h>            // memcpy
+#include <fcntl.h>             // open
+#include <unistd.h>            // pread, pwrite
 
 
 /**
@@ -26,28 +30,224 @@
  * ============================================================================
  */
 
-#define SCHEDULER_FCFS   1  // First Come, First Served
-#define SCHEDULER_SSTF   2  // Shortest Seek Time First  
-#define SCHEDULER_CSCAN  3  // Circular Scan
 #define ERROR_INVALID   -1  // Código de erro padrão
+#define DISK_FILE       "disk.dat"  // Arquivo do disco (o mesmo do disk-driver.o)
 
 // Estrutura para rastreamento de performance do disco
 typedef struct {
     int current_head_position;  // Posição atual da cabeça de leitura/escrita
     int total_head_movements;   // Total de blocos percorridos pela cabeça
     int requests_processed;     // Número de requisições processadas
+    int disk_operations;        // Operações enviadas ao disco
+    int merged_requests;        // Requisições atendidas junto com outra
+    int ra_blocks;              // Blocos lidos por antecipação
+    int ra_hits;                // Leituras atendidas pela antecipação
+    int ra_waits;               // Leituras que esperaram uma antecipação
+    int ra_cancels;             // Fluxos cancelados por acesso fora da sequência
     int active_policy;          // Política de escalonamento ativa
-    int last_direction;         // Última direção do movimento (CSCAN)
+    int last_direction;         // Sentido da varredura (SCAN/LOOK): 1 sobe, -1 desce
+    int turned;                 // Última escolha exigiu inverter ou voltar ao início
+    int expired_served;         // Atendidas por prazo vencido (DEADLINE)
 } disk_performance_tracker_t;
 
+// Histograma das latências: exato até LATENCY_EXACT ms; acima, cada
+// potência de 2 dividida em LATENCY_SUB faixas (erro de até 1/LATENCY_SUB)
+#define LATENCY_EXACT   16
+#define LATENCY_SUB     8
+#define LATENCY_BUCKETS (LATENCY_EXACT + (32 - 4) * LATENCY_SUB)
+
 // Estrutura para estatísticas operacionais
 typedef struct {
     unsigned int read_operations;       // Contador de operações de leitura
     unsigned int write_operations;      // Contador de operações de escrita
     unsigned int total_seek_distance;   // Distância total percorrida
     unsigned int average_response_time; // Tempo médio de resposta
+    unsigned int read_time;             // Soma das latências de leitura (ms)
+    unsigned int write_time;            // Soma das latências de escrita (ms)
+    unsigned int latencyHist[LATENCY_BUCKETS];  // Latências da fila à conclusão (ms), por faixa
+    unsigned int num_latencies;
+    unsigned int max_latency;           // Maior latência, exata
 } operation_stats_t;
 
+// Operação em andamento no disco: um intervalo de blocos consecutivos
+typedef struct {
+    int start;                          // Primeiro bloco
+    int count;                          // Blocos no intervalo
+    char* data;                         // Buffer contínuo do intervalo
+    char* bounce;                       // Buffer intermediário (NULL: é o da dona)
+    char* buffer;                       // DISK_MERGE_MAX blocos, reservado na inicialização
+    int ranged;                         // O driver transfere o intervalo inteiro
+} disk_operation_t;
+
+// Pool de requisições: vagas de tamanho fixo numa lista livre (por next),
+// cada uma com espaço para a cópia de um bloco (escrita de volta)
+typedef struct {
+    char* slots;                        // capacity vagas de stride bytes
+    size_t stride;                      // Requisição + um bloco, alinhado
+    diskrequest_t* free;                // Vagas livres
+    int capacity;
+    int available;                      // Vagas livres
+    int lowest;                         // Menor número de vagas livres já visto
+    int waiters;                        // Tarefas esperando uma vaga
+    unsigned int waits;                 // Esperas por vaga (pool vazio)
+    semaphore_t freed;                  // Onde esperam as tarefas
+} request_pool_t;
+
+// Segmento de leitura antecipada de um fluxo
+#define RA_EMPTY    0   // livre
+#define RA_WANTED   1   // pedido, esperando o disco ficar ocioso
+#define RA_PENDING  2   // sendo lido
+#define RA_READY    3   // com os dados
+
+typedef struct {
+    int state;                          // RA_EMPTY .. RA_READY
+    int start;                          // Primeiro bloco
+    int count;                          // Blocos no segmento
+    int cancelled;                      // Invalidado enquanto era lido
+    char* data;                         // DISK_RA_MAX blocos
+} ra_segment_t;
+
+// Fluxo de leitura sequencial de uma tarefa
+typedef struct {
+    int task_id;                        // Dona do fluxo (-1: livre)
+    int next;                           // Próximo bloco esperado
+    int run;                            // Leituras consecutivas até aqui
+    int window;                         // Tamanho da próxima antecipação
+    int waiting;                        // Dona esperando um segmento
+    unsigned int last_use;              // Para reaproveitar o mais antigo
+    semaphore_t ready;                  // Onde a dona espera o segmento
+    ra_segment_t seg[2];                // Um consumido, outro sendo lido
+} ra_stream_t;
+
+// Fila de requisições de uma tarefa (política FAIR) e sua contabilização
+#define FLOW_FREE     -1    // task_id de uma fila livre
+#define FLOW_BUCKETS  64    // baldes da tabela de filas por tarefa
+
+typedef struct disk_flow_t {
+    struct disk_flow_t* hnext;          // Próxima no balde da tabela
+    struct disk_flow_t* bnext;          // Próxima com pendentes
+    struct disk_flow_t* bprev;
+    int task_id;                        // Dona (FLOW_FREE: livre)
+    int exited;                         // Dona terminou com pendentes
+    int weight;                         // Peso, da prioridade da dona
+    diskrequest_t* head;                // Pendentes em ordem de chegada
+    diskrequest_t* tail;
+    int pending;
+    int outstanding;                    // Na fila ou no disco
+    struct disk_flow_t* anyWake;        // Dona em disk_wait_any: fila cujo semáforo liberar
+    semaphore_t anyDone;                // Onde a dona espera em disk_wait_any
+    unsigned long long vtime;           // Blocos atendidos, divididos pelo peso
+    unsigned int ops;                   // Requisições concluídas
+    unsigned long long bytes;           // Bytes lidos ou escritos
+    unsigned int wait;                  // Soma das latências (ms)
+} disk_flow_t;
+
+// Estado da política FAIR
+typedef struct {
+    disk_flow_t* buckets[FLOW_BUCKETS]; // Filas por task_id
+    disk_flow_t flows[DISK_FLOWS];      // Tabela das filas das tarefas
+    int numFlows;                       // Entradas da tabela já usadas
+    disk_flow_t system;                 // Requisições sem dona (write-back, antecipação)
+    disk_flow_t* backlog;               // Filas com pendentes
+    disk_flow_t* active;                // Fila da vez
+    int budget;                         // Blocos restantes na fatia
+    unsigned int sliceEnd;              // Fim da fatia (ms)
+    unsigned long long vtime;           // Tempo virtual: o da última fila escolhida
+    unsigned int slices;                // Fatias concedidas
+} fair_queue_t;
+
+// Entrada do cache de blocos: com dados (T1, T2) ou fantasma (B1, B2)
+typedef struct cache_entry_t {
+    struct cache_entry_t* prev;         // Vizinho mais antigo na lista
+    struct cache_entry_t* next;         // Vizinho mais recente na lista
+    struct cache_entry_t* hnext;        // Próximo no balde (ou na lista livre)
+    struct cache_list_t* list;          // Lista onde está a entrada
+    int block;                          // Bloco do disco
+    char* data;                         // Cópia do bloco (NULL nos fantasmas)
+    unsigned char dirty;                // Mais novo que o disco (write-back)
+    unsigned char flushing;             // Gravação em andamento no disco
+} cache_entry_t;
+
+// Lista de entradas em ordem de uso
+typedef struct cache_list_t {
+    cache_entry_t* lru;                 // Menos recentemente usada
+    cache_entry_t* mru;                 // Mais recentemente usada
+    int size;                           // Número de entradas
+} cache_list_t;
+
+// Cache de blocos: LRU usa só t1; ARC usa as quatro listas e o alvo p
+typedef struct {
+    int capacity;                       // Blocos com dados (0: desativado)
+    int policy;                         // DISK_CACHE_LRU ou DISK_CACHE_ARC
+    int target;                         // Alvo da ARC para o tamanho de t1
+    cache_list_t t1, t2, b1, b2;        // Recentes, frequentes e fantasmas
+    cache_entry_t** buckets;            // Tabela hash por número de bloco
+    unsigned int mask;                  // Número de baldes - 1
+    cache_entry_t* freeEntries;         // Entradas livres (por hnext)
+    char** freeData;                    // Buffers de dados livres
+    int numFreeData;
+    unsigned int hits;                  // Leituras atendidas pelo cache
+    unsigned int misses;                // Leituras que foram ao disco
+    unsigned int evictions;             // Blocos retirados do cache
+    unsigned int ghost_hits;            // Faltas com histórico (ARC)
+
+    int writeBack;                      // Escritas ficam no cache (write-back)
+    int dirtyLimit;                     // Sujos que disparam a gravação
+    int dirty;                          // Blocos sujos
+    int toFlush;                        // Sujos sem gravação em andamento
+    int flushing;                       // Gravações de volta em andamento
+    int syncWaiters;                    // Tarefas em disk_sync()
+    semaphore_t synced;                 // Onde esperam as tarefas em disk_sync()
+    diskrequest_t** batch;              // Requisições de uma gravação de volta
+    unsigned int write_hits;            // Escritas absorvidas pelo cache
+    unsigned int writebacks;            // Blocos gravados de volta
+} block_cache_t;
+
+
+// Um disco do sistema: o simulado, com fila, gerente, cache e métricas
+// próprios, ou um disco em faixas (RAID-0) sobre outros
+#define DEVICE_FREE     0   // entrada livre da tabela
+#define DEVICE_DISK     1   // disco simulado (disk_cmd)
+#define DEVICE_STRIPE   2   // faixas sobre discos simulados
+
+typedef struct disk_device_t {
+    int id;                                         // Índice na tabela de discos
+    int kind;                                       // DEVICE_FREE, DEVICE_DISK ou DEVICE_STRIPE
+    char* image;                                    // Arquivo de imagem do disco
+    disk_t disk;                                    // Fila e estado do disco
+    task_t manager;                                 // Tarefa gerenciadora do disco
+    disk_performance_tracker_t perf_tracker;        // Métricas de performance e posicionamento
+    operation_stats_t stats;                        // Estatísticas operacionais detalhadas
+    block_cache_t cache;                            // Cache de blocos do disco
+    disk_operation_t inflight;                      // Intervalo em andamento no disco
+    char* copy;                                     // DISK_MERGE_MAX blocos entre o cache e os iov
+    semaphore_t copyLock;                           // Uma tarefa de cada vez usa copy
+    int diskFile;                                   // Imagem do disco, para intervalos
+    ra_stream_t streams[DISK_RA_STREAMS];           // Fluxos de leitura antecipada
+    int raEnabled;                                  // Leitura antecipada ativa
+    fair_queue_t fair;                              // Filas por tarefa (FAIR)
+
+    int members[DISK_MAX_DEVICES];                  // Discos das faixas, em ordem
+    int numMembers;
+    int chunk;                                      // Blocos por faixa
+    diskrequest_t** pieces;                         // Pedaços pendentes de um readv/writev
+    int maxPieces;                                  // Pedaços por rodada
+    semaphore_t piecesLock;                         // Uma tarefa de cada vez usa pieces
+} disk_device_t;
+
+// Trace das operações do disco 0: registros acumulados e gravados de
+// DISK_TRACE_BUFFER em DISK_TRACE_BUFFER
+#ifndef DISK_TRACE_BUFFER
+#define DISK_TRACE_BUFFER 256
+#endif
+
+typedef struct {
+    int fd;                                         // Arquivo do trace (-1: desligado)
+    unsigned int start;                             // systime() no início
+    int count;                                      // Registros em buffer
+    disktrace_record_t buffer[DISK_TRACE_BUFFER];
+} disk_trace_t;
+
 
 /**
  * ============================================================================
@@ -55,28 +255,77 @@ typedef struct {
  * ============================================================================
  */
 
-disk_t disk;                                        // Estrutura principal do disco
-task_t taskDiskMgr;                                 // Tarefa gerenciadora do disco
-static disk_performance_tracker_t perf_tracker;     // Métricas de performance e posicionamento
-static operation_stats_t stats;                     // Estatísticas operacionais detalhadas
-static volatile int system_shutdown_requested = 0;  // Flag para encerramento controlado
+static disk_device_t devices[DISK_MAX_DEVICES];     // Discos; o 0 é o de disk_mgr_init
+static request_pool_t requestPool;                  // Vagas das requisições (de todos os discos)
+static volatile sig_atomic_t system_shutdown_requested = 0;  // Flag para encerramento controlado
+static disk_trace_t trace = { .fd = -1 };           // Trace das operações do disco 0
+static int cacheWriteMode = DISK_CACHE_WRITE;       // Escrita dos caches criados daqui em diante
+
+// Discos além do 0 só existem com o disco mapeado em memória (disk-driver-mmap.c);
+// com o disk-driver.o, disk_cmd_dev fica nulo
+extern int disk_cmd_dev(int dev, int cmd, int block, void* buffer) __attribute__((weak));
+extern int disk_cmd_range(int dev, int cmd, int block, int count, void* buffer) __attribute__((weak));
 
 // Protótipos das funções principais
 void bodyDiskManager(void *arg);
 void diskSignalHandler(int signum);
 diskrequest_t* disk_scheduler(void);
-diskrequest_t* createDiskRequest(int operation, int block, void* buffer);
+static diskrequest_t* createBlockRequest(disk_device_t* dev, int operation, int block, void* buffer);
+static diskrequest_t* createRangeRequest(disk_device_t* dev, int operation, int block, int count,
+                                         const struct iovec* iov, int iovcnt);
 
 // Protótipos das funções auxiliares
-static void updatePerformanceMetrics(int old_pos, int new_pos);
-static void printSystemStatistics(void);
-static void processCompletionEvents(void);
-static void processNewRequests(void);
-static int executeRequest(diskrequest_t* request);
-
-static diskrequest_t* fcfs_scheduler(void);
-static diskrequest_t* sstf_scheduler(void);
-static diskrequest_t* cscan_scheduler(void);
+static void updatePerformanceMetrics(disk_device_t* dev, int old_pos, int new_pos);
+static void printSystemStatistics(disk_device_t* dev);
+static void processCompletionEvents(disk_device_t* dev);
+static void processNewRequests(disk_device_t* dev);
+static int executeRequest(disk_device_t* dev, diskrequest_t* request);
+static int submitRequest(disk_device_t* dev, diskrequest_t* request);
+static void startRequest(disk_device_t* dev, diskrequest_t* request);
+static void finishNow(diskrequest_t* request, int status);
+static int collectRequest(diskrequest_t* request);
+static void wakeDiskManager(disk_device_t* dev);
+static void wakeAllManagers(void);
+static void waitForDiskEvent(disk_device_t* dev);
+
+static int cacheInit(disk_device_t* dev, int capacity, int blockSize);
+static int cacheLookup(disk_device_t* dev, int block, void* buffer);
+static int cacheLookupRange(disk_device_t* dev, int block, int count, char* buffer);
+static void cacheUpdate(disk_device_t* dev, int block, void* data, int isRead);
+static int cacheWrite(disk_device_t* dev, int block, void* data);
+static int cacheFlushDue(disk_device_t* dev);
+static void cacheFlushDone(disk_device_t* dev, diskrequest_t* request, int status);
+static void cacheWakeSyncers(disk_device_t* dev);
+static void processWriteBack(disk_device_t* dev);
+static int cacheHasDirty(disk_device_t* dev, int block, int count);
+static void raInit(disk_device_t* dev, int blockSize);
+static int raRead(disk_device_t* dev, int block, void* buffer);
+static void raInvalidate(disk_device_t* dev, int block, int count);
+static int raDue(disk_device_t* dev);
+static void processReadAhead(disk_device_t* dev);
+static void raDone(disk_device_t* dev, diskrequest_t* request, int status);
+static void completeRequest(disk_device_t* dev, diskrequest_t* request, int status, char* data);
+static void finishOperation(disk_device_t* dev, diskrequest_t* head, int status);
+static void mergeAdjacent(disk_device_t* dev, diskrequest_t* head);
+static void queueInsert(disk_device_t* dev, diskrequest_t* request);
+static void queueRemove(disk_device_t* dev, diskrequest_t* request);
+static void flowInit(disk_device_t* dev);
+static int requestPoolGrow(int capacity, int blockSize);
+static diskrequest_t* requestAlloc(void);
+static void requestFree(diskrequest_t* request);
+static void iovGather(char* dst, const struct iovec* iov, int iovcnt, size_t offset, size_t len);
+static void iovScatter(const struct iovec* iov, int iovcnt, size_t offset, const char* src, size_t len);
+static char* iovContiguous(const struct iovec* iov, int iovcnt, size_t offset, size_t len);
+
+static diskrequest_t* fcfs_scheduler(disk_device_t* dev);
+static diskrequest_t* sstf_scheduler(disk_device_t* dev);
+static diskrequest_t* cscan_scheduler(disk_device_t* dev);
+static diskrequest_t* elevator_scheduler(disk_device_t* dev);
+static diskrequest_t* deadline_scheduler(disk_device_t* dev);
+static diskrequest_t* fair_scheduler(disk_device_t* dev);
+static diskrequest_t* deviceSchedule(disk_device_t* dev);
+static void latencyRecord(disk_device_t* dev, unsigned int latency);
+static void traceRecord(int operation, int block);
 
 
 /**
@@ -85,76 +334,345 @@ static diskrequest_t* cscan_scheduler(void);
  * ============================================================================
  */
 
-int disk_mgr_init(int *numBlocks, int *blockSize) {
-    
-    // Validação de parâmetros de entrada
-    if (!numBlocks || !blockSize) {
+// Comando a um disco simulado: o 0 pelo disk_cmd, os demais pelo disk_cmd_dev
+static int deviceCmd(disk_device_t* dev, int cmd, int block, void* buffer) {
+    if (dev->id == 0) {
+        return disk_cmd(cmd, block, buffer);
+    }
+    return disk_cmd_dev ? disk_cmd_dev(dev->id, cmd, block, buffer) : ERROR_INVALID;
+}
+
+// Leitura ou escrita de um intervalo num só comando, com a latência do
+// intervalo inteiro; o disk-driver.o não tem disk_cmd_range e atende só
+// o primeiro bloco (os demais ficam para finishOperation)
+static int deviceRange(disk_device_t* dev, int cmd, int block, int count, void* buffer) {
+    dev->inflight.ranged = (disk_cmd_range != NULL);
+    if (dev->inflight.ranged) {
+        return disk_cmd_range(dev->id, cmd, block, count, buffer);
+    }
+    return deviceCmd(dev, cmd, block, buffer);
+}
+
+// Disco de um número, ou NULL se não existe
+static disk_device_t* deviceOf(int id) {
+    if (id < 0 || id >= DISK_MAX_DEVICES || devices[id].kind == DEVICE_FREE) {
+        return NULL;
+    }
+    return &devices[id];
+}
+
+// Entrada livre da tabela para um disco novo (o 0 fica para disk_mgr_init)
+static disk_device_t* deviceAlloc(void) {
+    int i;
+
+    for (i = 1; i < DISK_MAX_DEVICES; i++) {
+        if (devices[i].kind == DEVICE_FREE) {
+            return &devices[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Desfaz uma abertura que falhou depois de o disco simulado ser iniciado
+ *
+ * Fecha a imagem, libera o nome e os buffers e fecha o disco no driver
+ * (o disk-driver.o não fecha; só o mapeado em memória aceita
+ * DISK_CMD_CLOSE), deixando a entrada livre. As vagas já acrescentadas
+ * ao pool ficam para os outros discos.
+ *
+ * @param dev Disco em abertura
+ * @return ERROR_INVALID, para o retorno de deviceOpen
+ */
+static int deviceOpenFailed(disk_device_t* dev) {
+    if (dev->diskFile >= 0) {
+        close(dev->diskFile);
+    }
+    free(dev->image);
+    free(dev->inflight.buffer);
+    free(dev->copy);
+    deviceCmd(dev, DISK_CMD_CLOSE, 0, 0);
+
+    dev->diskFile        = -1;
+    dev->image           = NULL;
+    dev->inflight.buffer = NULL;
+    dev->copy            = NULL;
+    dev->kind            = DEVICE_FREE;
+    return ERROR_INVALID;
+}
+
+/**
+ * Inicializa um disco simulado e cria a sua tarefa gerenciadora
+ *
+ * Cada disco tem fila, política, cache, leitura antecipada e gerente
+ * próprios; o pool de requisições e o tratador de SIGUSR1 (instalado na
+ * primeira inicialização) são de todos.
+ *
+ * @param dev Entrada livre da tabela de discos
+ * @param image Arquivo de imagem do disco
+ * @return 0 em sucesso, ERROR_INVALID em erro
+ */
+static int deviceOpen(disk_device_t* dev, const char* image) {
+    static int handlerInstalled = 0;
+
+    if (dev->kind != DEVICE_FREE) {
         return ERROR_INVALID;
     }
+    memset(dev, 0, sizeof(disk_device_t));
+    dev->id       = dev - devices;
+    dev->diskFile = -1;
 
-    // Inicialização do hardware virtual do disco
-    if(disk_cmd(DISK_CMD_INIT, 0, 0) < 0) {
+    // Inicialização do hardware virtual do disco (o 0 é sempre o disk.dat)
+    if (deviceCmd(dev, DISK_CMD_INIT, 0, dev->id ? (void*)image : 0) < 0) {
         return ERROR_INVALID;
     }
-    
+
     // Consulta características físicas do disco
-    int disk_size  = disk_cmd(DISK_CMD_DISKSIZE, 0, 0);
-    int block_size = disk_cmd(DISK_CMD_BLOCKSIZE, 0, 0);
+    int disk_size  = deviceCmd(dev, DISK_CMD_DISKSIZE, 0, 0);
+    int block_size = deviceCmd(dev, DISK_CMD_BLOCKSIZE, 0, 0);
 
     if (disk_size < 0 || block_size < 0) {
-        return ERROR_INVALID;
+        return deviceOpenFailed(dev);
     }
 
     // Configuração da estrutura principal do disco
-    disk.numBlocks    = disk_size;      // Número total de blocos
-    disk.blockSize    = block_size;     // Tamanho de cada bloco
-    disk.diskQueue    = NULL;           // Fila de tarefas suspensas
-    disk.requestQueue = NULL;           // Fila de requisições pendentes
-    disk.livre        = 1;              // Disco inicialmente livre
-    disk.sinal        = 0;              // Sem sinais pendentes
+    dev->disk.numBlocks    = disk_size;      // Número total de blocos
+    dev->disk.blockSize    = block_size;     // Tamanho de cada bloco
+    dev->disk.current      = NULL;           // Nenhuma operação em andamento
+    dev->disk.requestQueue = NULL;           // Fila de requisições pendentes
+    dev->disk.requestIndex = NULL;           // Índice das pendentes por bloco
+    dev->disk.requestSeq = 0;                // Ordem de chegada
+    dev->disk.expireHead[0] = dev->disk.expireHead[1] = NULL;    // Prazos de leitura/escrita
+    dev->disk.expireTail[0] = dev->disk.expireTail[1] = NULL;
+    dev->disk.livre        = 1;              // Disco inicialmente livre
+    dev->disk.sinal        = 0;              // Sem sinais pendentes
 
     // Criação dos semáforos de controle de concorrência
-    sem_create(&disk.semaforo, 1);          // Semáforo principal do disco
-    sem_create(&disk.semaforo_queue, 1);    // Semáforo da fila de requisições
+    sem_create(&dev->disk.semaforo, 1);          // Semáforo principal do disco
+    sem_create(&dev->disk.semaforo_queue, 1);    // Semáforo da fila de requisições
 
     // Configuração inicial do tracker de performance
     #ifdef SCHEDULER_DEFAULT
-        perf_tracker.active_policy = SCHEDULER_DEFAULT;  // Política definida na compilação
+        dev->perf_tracker.active_policy = SCHEDULER_DEFAULT;  // Política definida na compilação
     #else
-        perf_tracker.active_policy = SCHEDULER_CSCAN;    // Política padrão se não definida
+        dev->perf_tracker.active_policy = SCHEDULER_CSCAN;    // Política padrão se não definida
     #endif
-    perf_tracker.current_head_position = 0;                // Cabeça inicia em 0
-    perf_tracker.total_head_movements  = 0;                // Sem movimentos ainda
-    perf_tracker.requests_processed    = 0;                // Nenhuma requisição processada
-    perf_tracker.last_direction        = 1;                // Direção crescente (CSCAN)
+    dev->perf_tracker.current_head_position = 0;                // Cabeça inicia em 0
+    dev->perf_tracker.total_head_movements  = 0;                // Sem movimentos ainda
+    dev->perf_tracker.requests_processed    = 0;                // Nenhuma requisição processada
+    dev->perf_tracker.disk_operations       = 0;                // Nenhuma operação no disco
+    dev->perf_tracker.merged_requests       = 0;                // Nenhuma requisição fundida
+    dev->perf_tracker.ra_blocks             = 0;                // Nenhuma antecipação
+    dev->perf_tracker.ra_hits               = 0;
+    dev->perf_tracker.ra_waits              = 0;
+    dev->perf_tracker.ra_cancels            = 0;
+    dev->perf_tracker.last_direction        = 1;                // Varredura começa subindo
+    dev->perf_tracker.turned                = 0;
+    dev->perf_tracker.expired_served        = 0;                // Nenhum prazo vencido
 
     // Inicialização das estatísticas operacionais
-    stats.read_operations       = 0;    // Contador de leituras
-    stats.write_operations      = 0;    // Contador de escritas
-    stats.total_seek_distance   = 0;    // Distância total percorrida
-    stats.average_response_time = 0;    // Tempo médio de resposta
+    dev->stats.read_operations       = 0;    // Contador de leituras
+    dev->stats.write_operations      = 0;    // Contador de escritas
+    dev->stats.total_seek_distance   = 0;    // Distância total percorrida
+    dev->stats.average_response_time = 0;    // Tempo médio de resposta
+    dev->stats.read_time             = 0;    // Latência acumulada das leituras
+    dev->stats.write_time            = 0;    // Latência acumulada das escritas
+
+    // Acesso direto ao arquivo do disco, para os blocos além do primeiro
+    // de cada intervalo (o disk-driver.o atende um bloco por comando)
+    dev->image    = strdup(image);
+    dev->diskFile = open(image, O_RDWR | O_SYNC);
+    if (!dev->image || dev->diskFile < 0) {
+        return deviceOpenFailed(dev);
+    }
+
+    // Vagas das requisições (cada disco acrescenta as suas), buffer dos
+    // intervalos fundidos e buffer de cópia entre o cache e os iov:
+    // depois daqui, atender uma requisição não aloca memória
+    dev->inflight.buffer = malloc((size_t)DISK_MERGE_MAX * block_size);
+    dev->copy            = malloc((size_t)DISK_MERGE_MAX * block_size);
+    sem_create(&dev->copyLock, 1);
+    if (!dev->inflight.buffer || !dev->copy ||
+        requestPoolGrow(DISK_REQUEST_POOL > 0 ? DISK_REQUEST_POOL : disk_size, block_size) < 0) {
+        return deviceOpenFailed(dev);
+    }
+
+    // Cache de blocos (sem memória, o gerente segue sem cache)
+    if (cacheInit(dev, DISK_CACHE_BLOCKS, block_size) < 0) {
+        dev->cache.capacity = 0;
+    }
+
+    // Fluxos de leitura antecipada
+    raInit(dev, block_size);
+
+    // Filas por tarefa da política FAIR
+    flowInit(dev);
 
     // Criação da tarefa gerenciadora do disco
-    task_create(&taskDiskMgr, bodyDiskManager, NULL);
+    dev->kind = DEVICE_DISK;
+    task_create(&dev->manager, bodyDiskManager, dev);
+
+    // Configuração do handler de sinais SIGUSR1, comum a todos os discos
+    if (!handlerInstalled) {
+        struct sigaction disk_handler;
+        disk_handler.sa_handler = diskSignalHandler;
+        sigemptyset(&disk_handler.sa_mask);
+        disk_handler.sa_flags = 0;
+
+        if (sigaction(SIGUSR1, &disk_handler, NULL) < 0) {
+            perror("Erro: falha na criação do handler");
+            exit(1);
+        }
+        handlerInstalled = 1;
+    }
+
+    return 0;
+}
+
+int disk_mgr_init(int *numBlocks, int *blockSize) {
 
-    // Configuração do handler de sinais SIGUSR1
-    struct sigaction disk_handler;
-    disk_handler.sa_handler = diskSignalHandler;
-    sigemptyset(&disk_handler.sa_mask);
-    disk_handler.sa_flags = 0;
+    // Validação de parâmetros de entrada
+    if (!numBlocks || !blockSize) {
+        return ERROR_INVALID;
+    }
 
-    if (sigaction(SIGUSR1, &disk_handler, NULL) < 0) {
-        perror("Erro: falha na criação do handler");
-        exit(1);
+    // O disco 0, no disk.dat
+    if (deviceOpen(&devices[0], DISK_FILE) < 0) {
+        return ERROR_INVALID;
     }
 
+    // Trace pedido na compilação (sem ele, o gerente segue normalmente)
+    #ifdef DISK_TRACE_FILE
+        if (disk_trace_start(DISK_TRACE_FILE) < 0) {
+            perror("Aviso: trace " DISK_TRACE_FILE);
+        }
+    #endif
+
     // Retorna informações do disco para o chamador
-    *numBlocks = disk_size;
-    *blockSize = block_size;
+    *numBlocks = devices[0].disk.numBlocks;
+    *blockSize = devices[0].disk.blockSize;
 
     return 0;
 }
 
+/**
+ * Inicializa mais um disco simulado, com outra imagem
+ *
+ * Só com o disco mapeado em memória (disk-driver-mmap.c), que atende
+ * vários discos; o disk-driver.o tem um só, o disco 0.
+ *
+ * @param image Arquivo de imagem do disco (o tamanho dá o número de blocos)
+ * @param numBlocks Recebe o tamanho do disco, em blocos
+ * @param blockSize Recebe o tamanho de cada bloco, em bytes
+ * @return Número do disco, ou ERROR_INVALID em erro
+ */
+int disk_dev_init(const char *image, int *numBlocks, int *blockSize) {
+    disk_device_t* dev = deviceAlloc();
+
+    if (!image || !numBlocks || !blockSize || !dev || !disk_cmd_dev) {
+        return ERROR_INVALID;
+    }
+    if (deviceOpen(dev, image) < 0) {
+        return ERROR_INVALID;
+    }
+
+    *numBlocks = dev->disk.numBlocks;
+    *blockSize = dev->disk.blockSize;
+    return dev->id;
+}
+
+/**
+ * Cria um disco em faixas (RAID-0) sobre discos já inicializados
+ *
+ * Os blocos do disco em faixas são distribuídos em faixas de chunk blocos
+ * seguidos, uma em cada membro, em rodízio: a faixa f fica no membro
+ * f % count. Blocos em membros diferentes são atendidos em paralelo, cada
+ * um pelo gerente do seu disco. O tamanho é o do menor membro (em faixas
+ * inteiras) vezes o número de membros. O disco em faixas não tem fila
+ * nem gerente: cada operação vai à fila do membro.
+ *
+ * @param members Números dos discos membros, todos diferentes
+ * @param count Número de membros (1 a DISK_MAX_DEVICES)
+ * @param chunk Blocos por faixa
+ * @param numBlocks Recebe o tamanho do disco em faixas, em blocos
+ * @param blockSize Recebe o tamanho de cada bloco (o mesmo nos membros)
+ * @return Número do disco em faixas, ou ERROR_INVALID em erro
+ */
+int disk_stripe_init(const int *members, int count, int chunk, int *numBlocks, int *blockSize) {
+    disk_device_t* dev = deviceAlloc();
+    disk_device_t* member;
+    int size = INT_MAX;
+    int i, j;
+
+    if (!members || count <= 0 || count > DISK_MAX_DEVICES || chunk <= 0 ||
+        !numBlocks || !blockSize || !dev) {
+        return ERROR_INVALID;
+    }
+
+    for (i = 0; i < count; i++) {
+        member = deviceOf(members[i]);
+        if (!member || member->kind != DEVICE_DISK ||
+            member->disk.blockSize != deviceOf(members[0])->disk.blockSize) {
+            return ERROR_INVALID;
+        }
+        for (j = 0; j < i; j++) {
+            if (members[j] == members[i]) {
+                return ERROR_INVALID;
+            }
+        }
+        if (member->disk.numBlocks < size) {
+            size = member->disk.numBlocks;
+        }
+    }
+    if (size < chunk) {
+        return ERROR_INVALID;
+    }
+
+    // Vetor dos pedaços de um readv/writev: numa rodada, até DISK_MERGE_MAX
+    // blocos de cada membro, que o seu gerente funde numa operação
+    memset(dev, 0, sizeof(disk_device_t));
+    dev->maxPieces = count * (chunk < DISK_MERGE_MAX ? DISK_MERGE_MAX / chunk : 1) + 1;
+    dev->pieces    = malloc(dev->maxPieces * sizeof(diskrequest_t*));
+    if (!dev->pieces) {
+        return ERROR_INVALID;
+    }
+    sem_create(&dev->piecesLock, 1);
+
+    dev->id         = dev - devices;
+    dev->kind       = DEVICE_STRIPE;
+    dev->numMembers = count;
+    dev->chunk      = chunk;
+    memcpy(dev->members, members, count * sizeof(int));
+    dev->disk.numBlocks = size / chunk * chunk * count;
+    dev->disk.blockSize = deviceOf(members[0])->disk.blockSize;
+
+    *numBlocks = dev->disk.numBlocks;
+    *blockSize = dev->disk.blockSize;
+    return dev->id;
+}
+
+// Membro que guarda um bloco do disco em faixas, e o bloco nele
+static disk_device_t* stripeMap(disk_device_t* dev, int block, int* memberBlock) {
+    int stripe = block / dev->chunk;
+
+    *memberBlock = stripe / dev->numMembers * dev->chunk + block % dev->chunk;
+    return &devices[dev->members[stripe % dev->numMembers]];
+}
+
+// Disco simulado e bloco nele que atendem um bloco do disco id (NULL se
+// o disco não existe ou o bloco está fora dele)
+static disk_device_t* deviceBlock(int id, int* block) {
+    disk_device_t* dev = deviceOf(id);
+
+    if (!dev || *block < 0 || *block >= dev->disk.numBlocks) {
+        return NULL;
+    }
+    if (dev->kind == DEVICE_STRIPE) {
+        dev = stripeMap(dev, *block, block);
+    }
+    return dev;
+}
+
 
 /**
  * ============================================================================
@@ -162,306 +680,2636 @@ int disk_mgr_init(int *numBlocks, int *blockSize) {
  * ============================================================================
  */
 
+/*
+ * Cada operação tem uma versão _dev, com o número do disco (o 0 é o de
+ * disk_mgr_init, os demais vêm de disk_dev_init e disk_stripe_init); as
+ * sem _dev usam o disco 0. Num disco em faixas, um bloco vai ao membro
+ * que o guarda, como se a operação fosse feita nele.
+ */
+
 /**
  * Lê um bloco do disco para um buffer
- * 
- * Cria uma requisição de leitura, adiciona à fila de processamento e
- * suspende a tarefa atual até que a operação seja concluída.
- * 
+ *
+ * Se o bloco estiver no cache ou já tiver sido lido por antecipação,
+ * copia-o sem suspender a tarefa. Senão, cria uma requisição de leitura,
+ * adiciona à fila de processamento e suspende a tarefa atual até que a
+ * operação seja concluída.
+ *
+ * @param id Número do disco
  * @param block Número do bloco a ser lido (0 a numBlocks-1)
  * @param buffer Buffer onde os dados lidos serão armazenados
  * @return 0 em sucesso, ERROR_INVALID em caso de erro
  */
-int disk_block_read(int block, void *buffer) {
+int disk_block_read_dev(int id, int block, void *buffer) {
+    disk_device_t* dev = deviceBlock(id, &block);
 
     // Validação de parâmetros
-    if(!buffer) {
+    if(!buffer || !dev) {
         return ERROR_INVALID;
     }
-    if (block < 0 || block >= disk.numBlocks) {
-        return ERROR_INVALID;
+    if (id == 0) {
+        traceRecord(DISK_CMD_READ, block);
     }
 
-    // Criação da requisição de leitura
-    diskrequest_t* request = createDiskRequest(DISK_CMD_READ, block, buffer);
-    if(!request) {
-        return ERROR_INVALID;
-    }
+    unsigned int start = systime();
+    int status = 0;
 
-    // Inserção na fila de requisições
-    sem_down(&disk.semaforo_queue);
-    queue_append((queue_t**)&disk.requestQueue, (queue_t*)request);
-    sem_up(&disk.semaforo_queue);
+    // Acerto no cache ou na leitura antecipada: não passa pelo gerente
+    if (!cacheLookup(dev, block, buffer) && !raRead(dev, block, buffer)) {
 
-    // Suspende tarefa atual até conclusão da operação
-    task_suspend(taskExec, &disk.diskQueue);
-    task_yield();
+        // Criação da requisição de leitura
+        diskrequest_t* request = createBlockRequest(dev, DISK_CMD_READ, block, buffer);
+        if(!request) {
+            return ERROR_INVALID;
+        }
+
+        // Entrega ao gerente e espera pela conclusão
+        status = submitRequest(dev, request);
+    }
 
     // Atualiza estatísticas de operações de leitura
-    stats.read_operations++;
-    
-    return 0;
+    dev->stats.read_operations++;
+    dev->stats.read_time += systime() - start;
+
+    return status;
+}
+
+int disk_block_read(int block, void *buffer) {
+    return disk_block_read_dev(0, block, buffer);
 }
 
 /**
  * Escreve um bloco do buffer para o disco
- * 
+ *
  * Cria uma requisição de escrita, adiciona à fila de processamento e
- * suspende a tarefa atual até que a operação seja concluída.
- * 
+ * suspende a tarefa atual até que a operação seja concluída. Em
+ * write-back, só atualiza o bloco no cache e retorna de imediato.
+ *
+ * @param id Número do disco
  * @param block Número do bloco a ser escrito (0 a numBlocks-1)
  * @param buffer Buffer contendo os dados a serem escritos
  * @return 0 em sucesso, ERROR_INVALID em caso de erro
  */
-int disk_block_write(int block, void *buffer) {
+int disk_block_write_dev(int id, int block, void *buffer) {
+    disk_device_t* dev = deviceBlock(id, &block);
 
     // Validação de parâmetros
-    if (!buffer) {
+    if (!buffer || !dev) {
         return ERROR_INVALID;
     }
-    if (block < 0 || block >= disk.numBlocks) {
-        return ERROR_INVALID;
+    if (id == 0) {
+        traceRecord(DISK_CMD_WRITE, block);
     }
 
-    // Criação da requisição de escrita
-    diskrequest_t* request = createDiskRequest(DISK_CMD_WRITE, block, buffer);
-    if(!request) {
-        return ERROR_INVALID;
-    }
+    unsigned int start = systime();
+    int status = 0;
 
-    // Inserção na fila de requisições
-    sem_down(&disk.semaforo_queue);
-    queue_append((queue_t**)&disk.requestQueue, (queue_t*)request);
-    sem_up(&disk.semaforo_queue);
+    // Leituras antecipadas deste bloco ficam velhas
+    raInvalidate(dev, block, 1);
 
-    // Suspende tarefa atual até conclusão da operação
-    task_suspend(taskExec, &disk.diskQueue);
-    task_yield();
+    // Write-back: o gerente grava o bloco depois
+    if (cacheWrite(dev, block, buffer)) {
+        wakeDiskManager(dev);
+    }
+    else {
+        // Criação da requisição de escrita
+        diskrequest_t* request = createBlockRequest(dev, DISK_CMD_WRITE, block, buffer);
+        if(!request) {
+            return ERROR_INVALID;
+        }
+
+        // Entrega ao gerente e espera pela conclusão
+        status = submitRequest(dev, request);
+    }
 
     // Atualiza estatísticas de operações de escrita
-    stats.write_operations++;
+    dev->stats.write_operations++;
+    dev->stats.write_time += systime() - start;
 
-    return 0;
+    return status;
 }
 
+int disk_block_write(int block, void *buffer) {
+    return disk_block_write_dev(0, block, buffer);
+}
 
 /**
- * ============================================================================
- * TAREFA GERENCIADORA
- * ============================================================================
- */
-
-/**
- * Corpo principal da tarefa gerenciadora do disco
- * 
- * Loop infinito que processa eventos de conclusão e novas requisições,
- * controlando todo o fluxo de operações do disco virtual.
- * 
- * @param arg Argumento não utilizado (NULL)
+ * Confere um intervalo de blocos e os buffers que o acompanham
+ *
+ * @return 1 se o intervalo cabe no disco e os buffers somam count blocos
  */
-void bodyDiskManager(void *arg) {
-    while(1) {
+static int rangeValid(disk_device_t* dev, int block, int count, const struct iovec* iov, int iovcnt) {
+    size_t len = 0;
+    int i;
 
-        // Verifica se deve encerrar o sistema
-        if (system_shutdown_requested && !disk.requestQueue && !disk.diskQueue) {
-            printSystemStatistics();
-            task_exit(0);
+    if (!dev || !iov || iovcnt <= 0 || count <= 0 || block < 0 || block + count > dev->disk.numBlocks) {
+        return 0;
+    }
+    for (i = 0; i < iovcnt; i++) {
+        if (!iov[i].iov_base && iov[i].iov_len) {
+            return 0;
         }
-        
-        // Processa eventos de conclusão de operações
-        processCompletionEvents();
-        
-        // Processa novas requisições pendentes
-        processNewRequests();
-        
-        // Cede processador para outras tarefas
-        task_yield();
+        len += iov[i].iov_len;
     }
+    return len == (size_t)count * dev->disk.blockSize;
 }
 
 /**
- * Processa eventos de conclusão de operações do disco
- * 
- * Verifica se há sinais pendentes do hardware e libera tarefas
- * que estavam aguardando conclusão de operações.
+ * Lê ou escreve um intervalo de um disco em faixas
+ *
+ * O intervalo é dividido nas faixas (e em pedaços de até DISK_MERGE_MAX
+ * blocos), e cada pedaço vira uma requisição na fila do membro que o
+ * guarda, com o deslocamento do pedaço nos buffers de iov: os dados vão
+ * direto dos buffers da tarefa aos membros, e vice-versa. Os pedaços de
+ * uma rodada (até dev->maxPieces) ficam pendentes ao mesmo tempo: os
+ * membros os atendem em paralelo, e as faixas seguidas de um mesmo membro
+ * são vizinhas nele, então o seu gerente as funde numa só operação. Um
+ * pedaço lido que está todo no cache do membro não vai ao disco, como em
+ * disk_block_readv.
+ *
+ * @param dev Disco em faixas
+ * @param operation DISK_CMD_READ ou DISK_CMD_WRITE
+ * @param block Primeiro bloco
+ * @param count Número de blocos
+ * @param iov Buffers dos blocos, que somam count * blockSize bytes
+ * @param iovcnt Número de buffers em iov
+ * @return 0 em sucesso, ERROR_INVALID se algum pedaço falhou
  */
-static void processCompletionEvents(void) {
-    sem_down(&disk.semaforo);
-    
-    if (disk.sinal) {
-        disk.sinal = 0;         // Limpa flag de sinal
-        disk.livre = 1;         // Marca disco como disponível
-        
-        // Acorda próxima tarefa da fila de espera
-        if (disk.diskQueue) {
-            task_resume(disk.diskQueue);
+static int stripeRange(disk_device_t* dev, int operation, int block, int count,
+                       const struct iovec* iov, int iovcnt) {
+    size_t bs = dev->disk.blockSize;
+    int used[DISK_MAX_DEVICES] = { 0 };
+    unsigned int start = systime();
+    int status = 0, k = 0, n, i, size, memberBlock, hit;
+
+    sem_down(&dev->piecesLock);
+
+    while (k < count && status == 0) {
+        // Uma rodada: cria os pedaços até encher o vetor
+        for (n = 0; k < count && n < dev->maxPieces; k += size) {
+            disk_device_t* member = stripeMap(dev, block + k, &memberBlock);
+
+            // Até o fim da faixa do bloco
+            size = dev->chunk - (block + k) % dev->chunk;
+            if (size > count - k) {
+                size = count - k;
+            }
+            if (size > DISK_MERGE_MAX) {
+                size = DISK_MERGE_MAX;
+            }
+            used[(block + k) / dev->chunk % dev->numMembers] = 1;
+
+            if (operation == DISK_CMD_READ) {
+                member->stats.read_operations += size;
+
+                // Todo no cache do membro: não vai ao disco
+                hit = 0;
+                if (member->cache.capacity) {
+                    sem_down(&member->copyLock);
+                    hit = cacheLookupRange(member, memberBlock, size, member->copy);
+                    if (hit) {
+                        iovScatter(iov, iovcnt, (size_t)k * bs, member->copy, (size_t)size * bs);
+                    }
+                    sem_up(&member->copyLock);
+                }
+                if (hit) {
+                    continue;
+                }
+            } else {
+                member->stats.write_operations += size;
+                raInvalidate(member, memberBlock, size);
+            }
+
+            diskrequest_t* request = createRangeRequest(member, operation, memberBlock, size, iov, iovcnt);
+            if (!request) {
+                status = ERROR_INVALID;
+                break;
+            }
+            request->offset = (size_t)k * bs;
+            startRequest(member, request);
+            dev->pieces[n++] = request;
+        }
+
+        // Espera todos os pedaços, mesmo depois de um erro (os buffers são da tarefa)
+        for (i = 0; i < n; i++) {
+            if (collectRequest(dev->pieces[i]) < 0) {
+                status = ERROR_INVALID;
+            }
         }
     }
-    
-    sem_up(&disk.semaforo);
-}
 
-/**
- * Processa novas requisições de acesso ao disco
- * 
- * Verifica se há requisições pendentes e o disco está livre,
- * selecionando e executando a próxima requisição.
- */
-static void processNewRequests(void) {
-    sem_down(&disk.semaforo);
-    
-    // Verifica se disco está livre e há requisições pendentes
-    if (disk.livre && disk.requestQueue) {
-        // Seleciona próxima requisição usando algoritmo ativo
-        diskrequest_t* next_request = disk_scheduler();
-        
-        if (next_request) {
-            // Remove requisição da fila
-            sem_down(&disk.semaforo_queue);
-            queue_remove((queue_t**)&disk.requestQueue, (queue_t*)next_request);
-            sem_up(&disk.semaforo_queue);
-            
-            // Executa a requisição selecionada
-            executeRequest(next_request);
-            free(next_request);
+    sem_up(&dev->piecesLock);
+
+    // O tempo da operação conta uma vez em cada membro, como num readv
+    for (i = 0; i < dev->numMembers; i++) {
+        if (used[i] && operation == DISK_CMD_READ) {
+            devices[dev->members[i]].stats.read_time += systime() - start;
+        } else if (used[i]) {
+            devices[dev->members[i]].stats.write_time += systime() - start;
         }
     }
-    
-    sem_up(&disk.semaforo);
-}
 
+    return status;
+}
 
 /**
- * ============================================================================
- * ALGORITMOS DE ESCALONAMENTO
- * ============================================================================
+ * Lê count blocos consecutivos para os buffers de iov
+ *
+ * O intervalo é lido em pedaços de até DISK_MERGE_MAX blocos: um pedaço
+ * todo no cache é copiado sem suspender a tarefa, e os demais são lidos
+ * cada um numa só operação do disco (num disco em faixas, uma por membro,
+ * em paralelo).
+ *
+ * @param id Número do disco
+ * @param block Primeiro bloco
+ * @param count Número de blocos
+ * @param iov Buffers de destino, que somam count * blockSize bytes
+ * @param iovcnt Número de buffers em iov
+ * @return 0 em sucesso, ERROR_INVALID em caso de erro
  */
+int disk_block_readv_dev(int id, int block, int count, const struct iovec *iov, int iovcnt) {
+    disk_device_t* dev = deviceOf(id);
 
-/**
- * Dispatcher principal dos algoritmos de escalonamento
- * 
- * Chama o algoritmo de escalonamento apropriado baseado na
- * política atualmente ativa no sistema.
- * 
- * @return Ponteiro para próxima requisição a ser processada
- */
-diskrequest_t* disk_scheduler(void) {
-    switch (perf_tracker.active_policy) {
-        case SCHEDULER_FCFS:
-            return fcfs_scheduler();
-        case SCHEDULER_SSTF:
-            return sstf_scheduler();
-        case SCHEDULER_CSCAN:
-            return cscan_scheduler();
-        default:
-            return fcfs_scheduler();
+    if (!rangeValid(dev, block, count, iov, iovcnt)) {
+        return ERROR_INVALID;
+    }
+    if (dev->kind == DEVICE_STRIPE) {
+        return stripeRange(dev, DISK_CMD_READ, block, count, iov, iovcnt);
     }
-}
 
-/**
- * Algoritmo FCFS - First Come, First Served
- * 
- * Implementa escalonamento simples: primeira requisição que
- * chegou é a primeira a ser atendida.
- * 
- * @return Ponteiro para primeira requisição da fila
- */
-static diskrequest_t* fcfs_scheduler(void) {
-    return (diskrequest_t*)disk.requestQueue;
+    unsigned int start = systime();
+    size_t bs = dev->disk.blockSize;
+    int status = 0;
+    int k, size, hit;
+
+    // Em pedaços de até DISK_MERGE_MAX blocos, que cabem no buffer de cópia
+    // e no dos intervalos fundidos
+    for (k = 0; k < count && status == 0; k += size) {
+        size = (count - k < DISK_MERGE_MAX) ? count - k : DISK_MERGE_MAX;
+
+        // Acerto em todos os blocos: não passa pelo gerente
+        hit = 0;
+        if (dev->cache.capacity) {
+            sem_down(&dev->copyLock);
+            hit = cacheLookupRange(dev, block + k, size, dev->copy);
+            if (hit) {
+                iovScatter(iov, iovcnt, (size_t)k * bs, dev->copy, (size_t)size * bs);
+            }
+            sem_up(&dev->copyLock);
+        }
+        if (!hit) {
+            diskrequest_t* request = createRangeRequest(dev, DISK_CMD_READ, block + k, size, iov, iovcnt);
+            if (request) {
+                request->offset = (size_t)k * bs;
+            }
+            status = request ? submitRequest(dev, request) : ERROR_INVALID;
+        }
+    }
+
+    dev->stats.read_operations += count;
+    dev->stats.read_time += systime() - start;
+
+    return status;
 }
 
-/**
- * Algoritmo SSTF - Shortest Seek Time First
- * 
- * Seleciona a requisição que requer menor movimento da cabeça
- * do disco a partir da posição atual.
- * 
- * @return Ponteiro para requisição com menor distância de seek
- */
-static diskrequest_t* sstf_scheduler(void) {
-    if (!disk.requestQueue) return NULL;
-    
-    diskrequest_t* best_request = NULL;         // Melhor requisição encontrada
-    diskrequest_t* current = (diskrequest_t*)disk.requestQueue;
-    int minimal_distance = INT_MAX;             // Menor distância encontrada
-    
-    // Busca requisição mais próxima da posição atual da cabeça
-    do {
-        int seek_distance = abs(current->block - perf_tracker.current_head_position);
-        if (seek_distance < minimal_distance) {
-            minimal_distance = seek_distance;
-            best_request = current;
-        }
-        current = current->next;
-    } while (current != (diskrequest_t*)disk.requestQueue);
-    
-    return best_request;
+int disk_block_readv(int block, int count, const struct iovec *iov, int iovcnt) {
+    return disk_block_readv_dev(0, block, count, iov, iovcnt);
 }
 
 /**
- * Algoritmo CSCAN - Circular Scan
- * 
- * Move a cabeça sempre em direção crescente. Quando chega ao fim,
- * retorna ao início do disco (movimento circular).
- * 
- * @return Ponteiro para próxima requisição na direção crescente
+ * Escreve count blocos consecutivos a partir dos buffers de iov
+ *
+ * O intervalo é escrito em pedaços de até DISK_MERGE_MAX blocos, cada um
+ * numa só operação do disco (num disco em faixas, uma por membro, em
+ * paralelo); em write-back, só atualiza os blocos no cache e retorna de
+ * imediato.
+ *
+ * @param id Número do disco
+ * @param block Primeiro bloco
+ * @param count Número de blocos
+ * @param iov Buffers de origem, que somam count * blockSize bytes
+ * @param iovcnt Número de buffers em iov
+ * @return 0 em sucesso, ERROR_INVALID em caso de erro
  */
-static diskrequest_t* cscan_scheduler(void) {
-    if (!disk.requestQueue) return NULL;
-    
-    diskrequest_t* forward_candidate = NULL;    // Candidato na direção crescente
-    diskrequest_t* wrap_candidate = NULL;       // Candidato para wrap circular
-    diskrequest_t* current = (diskrequest_t*)disk.requestQueue;
-    int min_forward_distance = INT_MAX;         // Menor distância à frente
-    int min_wrap_distance = INT_MAX;            // Menor posição para wrap
-    
-    // Busca candidatos em direção crescente e para wrap circular
-    do {
-        int block_position = current->block;
-        
-        if (block_position >= perf_tracker.current_head_position) {
-            // Candidato na direção crescente (preferencial)
-            int distance = block_position - perf_tracker.current_head_position;
-            if (distance < min_forward_distance) {
-                min_forward_distance = distance;
-                forward_candidate = current;
+int disk_block_writev_dev(int id, int block, int count, const struct iovec *iov, int iovcnt) {
+    disk_device_t* dev = deviceOf(id);
+
+    if (!rangeValid(dev, block, count, iov, iovcnt)) {
+        return ERROR_INVALID;
+    }
+    if (dev->kind == DEVICE_STRIPE) {
+        return stripeRange(dev, DISK_CMD_WRITE, block, count, iov, iovcnt);
+    }
+
+    unsigned int start = systime();
+    size_t bs = dev->disk.blockSize;
+    int status = 0;
+    int k, size, cached;
+
+    // Leituras antecipadas destes blocos ficam velhas
+    raInvalidate(dev, block, count);
+
+    // Em pedaços de até DISK_MERGE_MAX blocos, como na leitura
+    for (k = 0; k < count && status == 0; k += size) {
+        size = (count - k < DISK_MERGE_MAX) ? count - k : DISK_MERGE_MAX;
+
+        // Write-back: bloco a bloco no cache (sem espaço, o pedaço vai ao disco)
+        cached = 0;
+        if (dev->cache.writeBack) {
+            sem_down(&dev->copyLock);
+            iovGather(dev->copy, iov, iovcnt, (size_t)k * bs, (size_t)size * bs);
+            while (cached < size && cacheWrite(dev, block + k + cached, dev->copy + (size_t)cached * bs)) {
+                cached++;
             }
-        } else {
-            // Candidato para wrap circular (volta ao início)
-            if (block_position < min_wrap_distance) {
-                min_wrap_distance = block_position;
-                wrap_candidate = current;
+            sem_up(&dev->copyLock);
+            wakeDiskManager(dev);
+        }
+
+        if (cached < size) {
+            diskrequest_t* request = createRangeRequest(dev, DISK_CMD_WRITE, block + k, size, iov, iovcnt);
+            if (request) {
+                request->offset = (size_t)k * bs;
             }
+            status = request ? submitRequest(dev, request) : ERROR_INVALID;
         }
-        
-        current = current->next;
-    } while (current != (diskrequest_t*)disk.requestQueue);
-    
-    // Prioriza direção crescente, senão faz wrap circular
-    return forward_candidate ? forward_candidate : wrap_candidate;
+    }
+
+    dev->stats.write_operations += count;
+    dev->stats.write_time += systime() - start;
+
+    return status;
 }
 
+int disk_block_writev(int block, int count, const struct iovec *iov, int iovcnt) {
+    return disk_block_writev_dev(0, block, count, iov, iovcnt);
+}
 
 /**
- * ============================================================================
- * FUNÇÕES AUXILIARES
- * ============================================================================
+ * Entrega uma requisição ao gerente e suspende a tarefa até sua conclusão
+ *
+ * A tarefa espera no semáforo da própria requisição, liberado pelo gerente
+ * quando o disco conclui exatamente essa operação (ou quando o disco recusa
+ * o comando); uma conclusão anterior à espera não se perde.
+ *
+ * @param dev Disco da requisição
+ * @param request Requisição criada por createBlockRequest
+ * @return Status da operação (0 ou ERROR_INVALID)
  */
+static int submitRequest(disk_device_t* dev, diskrequest_t* request) {
 
-/**
- * Cria uma nova requisição de disco
+    startRequest(dev, request);
+
+    // Suspende tarefa atual até conclusão da operação
+    return collectRequest(request);
+}
+
+// Coloca a requisição na fila e acorda o gerente, que pode estar dormindo
+static void startRequest(disk_device_t* dev, diskrequest_t* request) {
+    disk_enqueue(request);
+    wakeDiskManager(dev);
+}
+
+// Conclui na hora uma requisição que não precisou ir ao disco
+static void finishNow(diskrequest_t* request, int status) {
+    request->status   = status;
+    request->finished = 1;
+    sem_up(&request->done);
+}
+
+// Espera a conclusão da requisição, libera-a e retorna o status
+static int collectRequest(diskrequest_t* request) {
+    sem_down(&request->done);
+
+    int status = request->status;
+    requestFree(request);
+
+    return status;
+}
+
+
+/**
+ * ============================================================================
+ * INTERFACE ASSÍNCRONA
+ * ============================================================================
+ */
+
+/*
+ * disk_submit_read/disk_submit_write criam a requisição e a colocam na
+ * fila sem suspender a tarefa: uma tarefa pode manter dezenas de operações
+ * pendentes, e as políticas que reordenam (SSTF, CSCAN, ...) enxergam uma
+ * fila mais funda. O descritor é a própria requisição; quem espera é a
+ * dona, no semáforo dela (disk_wait) ou no da sua fila por tarefa
+ * (disk_wait_any). Acertos no cache e escritas absorvidas pelo write-back
+ * já voltam concluídos. As assíncronas não passam pela leitura antecipada,
+ * que acompanha só as leituras síncronas em sequência. Num disco em
+ * faixas, o descritor é o da requisição no membro.
+ */
+
+/**
+ * Enfileira a leitura de um bloco sem suspender a tarefa
+ *
+ * @param id Número do disco
+ * @param block Número do bloco a ser lido (0 a numBlocks-1)
+ * @param buffer Onde os dados serão colocados (válido até a conclusão)
+ * @return Descritor da operação, ou NULL em erro
+ */
+diskrequest_t* disk_submit_read_dev(int id, int block, void *buffer) {
+    disk_device_t* dev = deviceBlock(id, &block);
+
+    if (!buffer || !dev) {
+        return NULL;
+    }
+
+    diskrequest_t* request = createBlockRequest(dev, DISK_CMD_READ, block, buffer);
+    if (!request) {
+        return NULL;
+    }
+
+    dev->stats.read_operations++;
+    if (cacheLookup(dev, block, buffer)) {
+        finishNow(request, 0);
+    } else {
+        startRequest(dev, request);
+    }
+    return request;
+}
+
+diskrequest_t* disk_submit_read(int block, void *buffer) {
+    return disk_submit_read_dev(0, block, buffer);
+}
+
+/**
+ * Enfileira a escrita de um bloco sem suspender a tarefa
+ *
+ * @param id Número do disco
+ * @param block Número do bloco a ser escrito (0 a numBlocks-1)
+ * @param buffer Dados a escrever (válido até a conclusão)
+ * @return Descritor da operação, ou NULL em erro
+ */
+diskrequest_t* disk_submit_write_dev(int id, int block, void *buffer) {
+    disk_device_t* dev = deviceBlock(id, &block);
+
+    if (!buffer || !dev) {
+        return NULL;
+    }
+
+    diskrequest_t* request = createBlockRequest(dev, DISK_CMD_WRITE, block, buffer);
+    if (!request) {
+        return NULL;
+    }
+
+    dev->stats.write_operations++;
+    raInvalidate(dev, block, 1);
+    if (cacheWrite(dev, block, buffer)) {
+        wakeDiskManager(dev);
+        finishNow(request, 0);
+    } else {
+        startRequest(dev, request);
+    }
+    return request;
+}
+
+diskrequest_t* disk_submit_write(int block, void *buffer) {
+    return disk_submit_write_dev(0, block, buffer);
+}
+
+/**
+ * Espera a conclusão de uma operação assíncrona e libera o descritor
+ *
+ * Retorna de imediato se ela já concluiu. O tempo da submissão à coleta
+ * entra na latência média de leitura ou escrita do relatório.
+ *
+ * @param handle Descritor retornado por disk_submit_read/disk_submit_write
+ * @return Status da operação (0 ou ERROR_INVALID)
+ */
+int disk_wait(diskrequest_t *handle) {
+    if (!handle) {
+        return ERROR_INVALID;
+    }
+
+    disk_device_t* dev = handle->device;
+    unsigned int submitted = handle->arrival;
+    int read = (handle->operation == DISK_CMD_READ);
+    int status = collectRequest(handle);
+
+    if (read) {
+        dev->stats.read_time += systime() - submitted;
+    } else {
+        dev->stats.write_time += systime() - submitted;
+    }
+    return status;
+}
+
+/**
+ * Espera até que uma das operações assíncronas da tarefa conclua
+ *
+ * Os descritores pendentes são todos da tarefa atual, então estão na
+ * fila dela em cada disco: a conferência e o pedido para ser acordada são
+ * feitos com a preempção desabilitada, e o gerente, ao concluir qualquer
+ * uma delas, libera o semáforo da fila da primeira pendente (as filas de
+ * outros discos apontam para ela em anyWake). Não libera o descritor.
+ *
+ * @param handles Descritores (entradas NULL são ignoradas)
+ * @param n Número de entradas em handles
+ * @return Índice de um descritor concluído, ou ERROR_INVALID se não há nenhum
+ */
+int disk_wait_any(diskrequest_t **handles, int n) {
+    disk_flow_t* flow;
+    int i, done;
+
+    if (!handles || n <= 0) {
+        return ERROR_INVALID;
+    }
+
+    while (1) {
+        flow = NULL;
+        done = ERROR_INVALID;
+
+        PPOS_PREEMPT_DISABLE;
+        for (i = 0; i < n && done < 0; i++) {
+            if (!handles[i]) {
+                continue;
+            }
+            if (handles[i]->finished) {
+                done = i;
+            } else if (!flow) {
+                flow = handles[i]->flow;
+            }
+        }
+
+        // Concluída ou nenhuma pendente: desfaz os pedidos para ser acordada
+        if (done >= 0 || !flow) {
+            for (i = 0; i < n; i++) {
+                if (handles[i] && !handles[i]->finished) {
+                    handles[i]->flow->anyWake = NULL;
+                }
+            }
+            PPOS_PREEMPT_ENABLE;
+            return done;
+        }
+        for (i = 0; i < n; i++) {
+            if (handles[i]) {
+                handles[i]->flow->anyWake = flow;
+            }
+        }
+        PPOS_PREEMPT_ENABLE;
+
+        sem_down(&flow->anyDone);
+    }
+}
+
+/**
+ * Confere, sem esperar, se uma operação assíncrona concluiu
+ *
+ * @param handle Descritor retornado por disk_submit_read/disk_submit_write
+ * @return 1 se concluiu, 0 se não, ERROR_INVALID se o descritor é NULL
+ */
+int disk_poll(diskrequest_t *handle) {
+    if (!handle) {
+        return ERROR_INVALID;
+    }
+    return handle->finished;
+}
+
+
+/**
+ * ============================================================================
+ * TAREFA GERENCIADORA
+ * ============================================================================
+ */
+
+/**
+ * Corpo principal da tarefa gerenciadora de um disco
+ * 
+ * Loop infinito que processa eventos de conclusão e novas requisições,
+ * controlando todo o fluxo de operações do disco virtual. Sem nada a
+ * fazer, o gerente dorme até o próximo sinal do disco, requisição,
+ * escrita no cache, disk_sync(), pedido de leitura antecipada ou de
+ * encerramento, sem consumir processador.
+ * 
+ * @param arg Disco gerenciado (disk_device_t)
+ */
+void bodyDiskManager(void *arg) {
+    disk_device_t* dev = arg;
+
+    while(1) {
+
+        // Verifica se deve encerrar o sistema (com os sujos já gravados)
+        if (system_shutdown_requested && !dev->disk.requestQueue && !dev->disk.current &&
+            !dev->cache.dirty && !dev->cache.flushing) {
+            printSystemStatistics(dev);
+            task_exit(0);
+        }
+        
+        // Processa eventos de conclusão de operações
+        processCompletionEvents(dev);
+        cacheWakeSyncers(dev);
+
+        // Grava blocos sujos do cache, se for a hora
+        processWriteBack(dev);
+
+        // Antecipa leituras sequenciais, se o disco estiver ocioso
+        processReadAhead(dev);
+        
+        // Processa novas requisições pendentes
+        processNewRequests(dev);
+        
+        // Dorme até haver algo a fazer
+        waitForDiskEvent(dev);
+    }
+}
+
+/**
+ * Acorda o gerente se ele estiver dormindo
+ * 
+ * O gerente ocioso dorme na fila de tarefas adormecidas do núcleo com
+ * despertar em UINT_MAX; zerar awakeTime faz o dispatcher retomá-lo na
+ * próxima varredura dessa fila. Como é uma única escrita, pode ser feita
+ * também pelo handler de sinal, que não pode mexer nas filas do núcleo.
+ * 
+ * @param dev Disco do gerente
+ */
+static void wakeDiskManager(disk_device_t* dev) {
+    dev->manager.awakeTime = 0;
+}
+
+// Acorda os gerentes de todos os discos
+static void wakeAllManagers(void) {
+    int i;
+
+    for (i = 0; i < DISK_MAX_DEVICES; i++) {
+        if (devices[i].kind == DEVICE_DISK) {
+            wakeDiskManager(&devices[i]);
+        }
+    }
+}
+
+// A tarefa é o gerente de algum disco?
+static int isDiskManager(task_t* task) {
+    int i;
+
+    for (i = 0; i < DISK_MAX_DEVICES; i++) {
+        if (devices[i].kind == DEVICE_DISK && task == &devices[i].manager) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Suspende o gerente até o próximo evento do disco
+ * 
+ * O despertar é armado antes de conferir se há trabalho: um evento que
+ * chegue depois disso zera awakeTime e o sono termina na próxima
+ * varredura do dispatcher, então nenhum sinal ou requisição se perde.
+ * 
+ * @param dev Disco do gerente
+ */
+static void waitForDiskEvent(disk_device_t* dev) {
+    dev->manager.awakeTime = UINT_MAX;
+    PPOS_BARRIER();
+
+    // Conclusão pendente, requisição que pode ser iniciada, blocos sujos
+    // a gravar, leitura antecipada ou encerramento
+    if (dev->disk.sinal || (dev->disk.livre && dev->disk.requestQueue) || cacheFlushDue(dev) ||
+        raDue(dev) ||
+        (system_shutdown_requested && !dev->disk.requestQueue && !dev->disk.current &&
+         !dev->cache.dirty && !dev->cache.flushing)) {
+        return;
+    }
+
+    // Como task_sleep, mas sem prazo (preempção desabilitada até o estado 's')
+    PPOS_PREEMPT_DISABLE;
+    task_suspend(taskExec, &sleepQueue);
+    PPOS_PREEMPT_ENABLE;
+    task_yield();
+}
+
+/**
+ * Processa eventos de conclusão de operações do disco
+ * 
+ * Verifica se há sinais pendentes do hardware e conclui a requisição
+ * que estava em andamento. O SIGUSR1 é o mesmo para todos os discos:
+ * a operação deste só terminou se o disco simulado está livre.
+ * 
+ * @param dev Disco do gerente
+ */
+static void processCompletionEvents(disk_device_t* dev) {
+    sem_down(&dev->disk.semaforo);
+    
+    if (dev->disk.sinal) {
+        dev->disk.sinal = 0;         // Limpa flag de sinal
+        
+        diskrequest_t* done = dev->disk.current;
+        if (done && deviceCmd(dev, DISK_CMD_STATUS, 0, 0) == DISK_STATUS_IDLE) {
+            dev->disk.current = NULL;
+            dev->disk.livre = 1;     // Marca disco como disponível
+            finishOperation(dev, done, 0);
+        }
+    }
+    
+    sem_up(&dev->disk.semaforo);
+}
+
+/**
+ * Processa novas requisições de acesso ao disco
+ * 
+ * Verifica se há requisições pendentes e o disco está livre,
+ * selecionando e executando a próxima requisição.
+ * 
+ * @param dev Disco do gerente
+ */
+static void processNewRequests(disk_device_t* dev) {
+    sem_down(&dev->disk.semaforo);
+    
+    // Verifica se disco está livre e há requisições pendentes
+    if (dev->disk.livre && dev->disk.requestQueue) {
+        // Seleciona próxima requisição usando algoritmo ativo e a retira
+        // da fila, com as vizinhas (tarefas podem inserir ao mesmo tempo)
+        sem_down(&dev->disk.semaforo_queue);
+        diskrequest_t* next_request = deviceSchedule(dev);
+        if (next_request) {
+            queueRemove(dev, next_request);
+            mergeAdjacent(dev, next_request);
+        }
+        sem_up(&dev->disk.semaforo_queue);
+
+        // Executa (em andamento até o sinal)
+        if (next_request) {
+            executeRequest(dev, next_request);
+        }
+    }
+    
+    sem_up(&dev->disk.semaforo);
+}
+
+
+/**
+ * ============================================================================
+ * FILA DE REQUISIÇÕES
+ * ============================================================================
+ */
+
+/*
+ * As requisições pendentes ficam em duas estruturas: a fila em ordem de
+ * chegada (disk.requestQueue, usada pelo FCFS) e um índice ordenado por
+ * (bloco, ordem de chegada), usado pelo SSTF, pelo CSCAN e pela fusão de
+ * vizinhas. O índice é uma treap: árvore de busca em que cada nó também
+ * obedece a um heap de prioridades pseudoaleatórias (hash da ordem de
+ * chegada), o que a mantém com altura O(log n) esperada sem rebalanceamento
+ * explícito. Inserção, remoção e as buscas de piso/teto são O(log n), e
+ * a remoção da fila é O(1), sem percorrê-la como o queue_remove.
+ *
+ * Cada pendente também fica na lista de prazos da sua operação (leitura
+ * ou escrita), em ordem de chegada: como o prazo é a chegada mais um
+ * valor fixo por operação, a primeira de cada lista é a de prazo menor.
+ *
+ * E fica ainda na fila da tarefa dona (as sem dona, na fila do sistema),
+ * em ordem de chegada, usada pela política FAIR, que também guarda ali a
+ * E/S de cada tarefa. As filas com pendentes formam a lista de backlog.
+ * As filas vêm de uma tabela de DISK_FLOWS reservada na inicialização:
+ * a de uma tarefa que terminou fica livre (FLOW_FREE) e é reaproveitada,
+ * de preferência por uma tarefa do mesmo balde. Com a tabela cheia, a
+ * tarefa usa a fila do sistema.
+ *
+ * As funções sem trava supõem disk.semaforo_queue obtido pelo chamador.
+ */
+
+// Prioridade do nó na treap (hash multiplicativo de Knuth)
+#define INDEX_PRIO(r) ((r)->seq * 2654435761u)
+
+// a vem antes de b no índice?
+static int indexLess(const diskrequest_t* a, const diskrequest_t* b) {
+    return a->block < b->block || (a->block == b->block && a->seq < b->seq);
+}
+
+static diskrequest_t* rotateRight(diskrequest_t* node) {
+    diskrequest_t* left = node->left;
+    node->left  = left->right;
+    left->right = node;
+    return left;
+}
+
+static diskrequest_t* rotateLeft(diskrequest_t* node) {
+    diskrequest_t* right = node->right;
+    node->right = right->left;
+    right->left = node;
+    return right;
+}
+
+// Insere request na subárvore, devolvendo a nova raiz
+static diskrequest_t* indexInsert(diskrequest_t* root, diskrequest_t* request) {
+    if (!root) {
+        return request;
+    }
+    if (indexLess(request, root)) {
+        root->left = indexInsert(root->left, request);
+        if (INDEX_PRIO(root->left) > INDEX_PRIO(root)) {
+            root = rotateRight(root);
+        }
+    } else {
+        root->right = indexInsert(root->right, request);
+        if (INDEX_PRIO(root->right) > INDEX_PRIO(root)) {
+            root = rotateLeft(root);
+        }
+    }
+    return root;
+}
+
+// Junta duas subárvores (todas as chaves de a antes das de b)
+static diskrequest_t* indexJoin(diskrequest_t* a, diskrequest_t* b) {
+    if (!a) return b;
+    if (!b) return a;
+    if (INDEX_PRIO(a) > INDEX_PRIO(b)) {
+        a->right = indexJoin(a->right, b);
+        return a;
+    }
+    b->left = indexJoin(a, b->left);
+    return b;
+}
+
+// Retira request da subárvore, devolvendo a nova raiz
+static diskrequest_t* indexRemove(diskrequest_t* root, diskrequest_t* request) {
+    if (!root) {
+        return NULL;
+    }
+    if (root == request) {
+        root = indexJoin(request->left, request->right);
+        request->left = request->right = NULL;
+        return root;
+    }
+    if (indexLess(request, root)) {
+        root->left = indexRemove(root->left, request);
+    } else {
+        root->right = indexRemove(root->right, request);
+    }
+    return root;
+}
+
+/**
+ * Primeira requisição do índice com chave (bloco, chegada) >= (block, seq)
+ * 
+ * @param block Bloco procurado
+ * @param seq Ordem de chegada mínima no próprio bloco (0: todas)
+ * @return Requisição encontrada ou NULL se não houver
+ */
+static diskrequest_t* indexCeiling(disk_device_t* dev, int block, unsigned int seq) {
+    diskrequest_t* node = dev->disk.requestIndex;
+    diskrequest_t* best = NULL;
+
+    while (node) {
+        if (node->block > block || (node->block == block && node->seq >= seq)) {
+            best = node;
+            node = node->left;
+        } else {
+            node = node->right;
+        }
+    }
+    return best;
+}
+
+/**
+ * Última requisição do índice com bloco abaixo de block
+ * 
+ * @param block Limite (exclusivo)
+ * @return Requisição encontrada ou NULL se não houver
+ */
+static diskrequest_t* indexFloor(disk_device_t* dev, int block) {
+    diskrequest_t* node = dev->disk.requestIndex;
+    diskrequest_t* best = NULL;
+
+    while (node) {
+        if (node->block < block) {
+            best = node;
+            node = node->right;
+        } else {
+            node = node->left;
+        }
+    }
+    return best;
+}
+
+/**
+ * Escolhe entre as requisições de um bloco como a varredura da fila faria
+ * 
+ * A varredura visitava a mais antiga da fila e depois as demais da mais
+ * nova para a mais velha, ficando com a primeira de menor distância.
+ * 
+ * @param block Bloco escolhido pelo escalonador
+ * @return A mais antiga da fila, se for desse bloco, senão a mais nova dele
+ */
+static diskrequest_t* indexPick(disk_device_t* dev, int block) {
+    diskrequest_t* oldest = dev->disk.requestQueue;
+
+    if (oldest->block == block) {
+        return oldest;
+    }
+    return indexFloor(dev, block + 1);
+}
+
+// Próxima requisição no índice, depois de request
+static diskrequest_t* indexNext(disk_device_t* dev, diskrequest_t* request) {
+    return indexCeiling(dev, request->block, request->seq + 1);
+}
+
+// Lista de prazos da operação da requisição (0: leitura, 1: escrita)
+#define EXPIRE_LIST(r) ((r)->operation == DISK_CMD_READ ? 0 : 1)
+
+// Peso de uma prioridade: -20 = 41, 0 = 21, +20 = 1 (como os tickets do stride)
+#define FLOW_WEIGHT(prio) (20 - (prio) + 1)
+
+// Escala do tempo virtual: cada bloco atendido avança FLOW_SCALE / peso
+#define FLOW_SCALE (1 << 20)
+
+// Folga no tempo virtual dentro da qual a fila mais perto da cabeça pode
+// passar à frente: DISK_FAIR_WINDOW blocos de uma tarefa de prioridade 0
+#define FLOW_WINDOW ((unsigned long long)DISK_FAIR_WINDOW * FLOW_SCALE / FLOW_WEIGHT(0))
+
+// Esvazia a fila e a entrega a task_id
+static void flowReset(disk_flow_t* flow, int task_id) {
+    flow->bnext   = flow->bprev = NULL;
+    flow->exited  = 0;
+    flow->weight  = FLOW_WEIGHT(0);
+    flow->head    = flow->tail = NULL;
+    flow->pending = 0;
+    flow->outstanding = 0;
+    flow->anyWake     = NULL;
+    flow->vtime   = 0;
+    flow->ops     = 0;
+    flow->bytes   = 0;
+    flow->wait    = 0;
+    flow->task_id = task_id;
+}
+
+static void flowInit(disk_device_t* dev) {
+    int i;
+
+    memset(&dev->fair, 0, sizeof(dev->fair));
+    flowReset(&dev->fair.system, FLOW_FREE);
+    sem_create(&dev->fair.system.anyDone, 0);
+    for (i = 0; i < DISK_FLOWS; i++) {
+        flowReset(&dev->fair.flows[i], FLOW_FREE);
+        sem_create(&dev->fair.flows[i].anyDone, 0);
+    }
+}
+
+// Fila de task_id na tabela, ou NULL
+static disk_flow_t* flowFind(disk_device_t* dev, int task_id) {
+    disk_flow_t* flow;
+
+    for (flow = dev->fair.buckets[task_id & (FLOW_BUCKETS - 1)]; flow; flow = flow->hnext) {
+        if (flow->task_id == task_id) {
+            return flow;
+        }
+    }
+    return NULL;
+}
+
+// Fila livre para uma tarefa nova, posta no balde: uma livre do próprio
+// balde, uma ainda não usada da tabela ou uma livre de outro balde; NULL
+// com todas ocupadas (com a trava)
+static disk_flow_t* flowTake(disk_device_t* dev, disk_flow_t** bucket) {
+    disk_flow_t *flow, **link;
+    int i;
+
+    for (flow = *bucket; flow && flow->task_id != FLOW_FREE; flow = flow->hnext)
+        ;
+    if (flow) {
+        return flow;
+    }
+
+    if (dev->fair.numFlows < DISK_FLOWS) {
+        flow = &dev->fair.flows[dev->fair.numFlows++];
+    }
+    for (i = 0; i < FLOW_BUCKETS && !flow; i++) {
+        for (link = &dev->fair.buckets[i]; *link; link = &(*link)->hnext) {
+            if ((*link)->task_id == FLOW_FREE) {
+                flow  = *link;
+                *link = flow->hnext;
+                break;
+            }
+        }
+    }
+    if (flow) {
+        flow->hnext = *bucket;
+        *bucket = flow;
+    }
+    return flow;
+}
+
+// Fila da tarefa, tomada da tabela no seu primeiro pedido (com a trava)
+static disk_flow_t* flowOf(disk_device_t* dev, task_t* task) {
+    if (!task) {
+        return &dev->fair.system;
+    }
+
+    disk_flow_t* flow = flowFind(dev, task->id);
+    if (!flow) {
+        flow = flowTake(dev, &dev->fair.buckets[task->id & (FLOW_BUCKETS - 1)]);
+        if (!flow) {
+            return &dev->fair.system;    // tabela cheia, usa a fila do sistema
+        }
+        flowReset(flow, task->id);
+    }
+
+    // Peso atualizado a cada pedido, seguindo task_setprio; as tarefas do
+    // núcleo não têm prioridade própria
+    flow->weight = FLOW_WEIGHT(task->id > 1 ? task_getprio(task) : 0);
+    return flow;
+}
+
+// Coloca a requisição no fim da fila da tarefa (com a trava)
+static void flowPush(disk_device_t* dev, disk_flow_t* flow, diskrequest_t* request) {
+    request->flow     = flow;
+    request->flowNext = NULL;
+    request->flowPrev = flow->tail;
+    if (flow->tail) {
+        flow->tail->flowNext = request;
+    } else {
+        flow->head = request;
+    }
+    flow->tail = request;
+    flow->outstanding++;
+
+    // Voltou a ter pendentes: entra no backlog sem crédito pelo tempo parada
+    if (flow->pending++ == 0) {
+        if (flow->vtime < dev->fair.vtime) {
+            flow->vtime = dev->fair.vtime;
+        }
+        flow->bprev = NULL;
+        flow->bnext = dev->fair.backlog;
+        if (dev->fair.backlog) {
+            dev->fair.backlog->bprev = flow;
+        }
+        dev->fair.backlog = flow;
+    }
+}
+
+// Retira a requisição da fila da tarefa (com a trava)
+static void flowUnlink(disk_device_t* dev, diskrequest_t* request) {
+    disk_flow_t* flow = request->flow;
+
+    if (request->flowPrev) {
+        request->flowPrev->flowNext = request->flowNext;
+    } else {
+        flow->head = request->flowNext;
+    }
+    if (request->flowNext) {
+        request->flowNext->flowPrev = request->flowPrev;
+    } else {
+        flow->tail = request->flowPrev;
+    }
+    request->flowPrev = request->flowNext = NULL;
+
+    if (--flow->pending == 0) {
+        if (flow->bprev) {
+            flow->bprev->bnext = flow->bnext;
+        } else {
+            dev->fair.backlog = flow->bnext;
+        }
+        if (flow->bnext) {
+            flow->bnext->bprev = flow->bprev;
+        }
+        flow->bprev = flow->bnext = NULL;
+    }
+}
+
+// Coloca a requisição no fim da fila, no índice e na lista de prazos (com a trava)
+static void queueInsert(disk_device_t* dev, diskrequest_t* request) {
+    int list = EXPIRE_LIST(request);
+
+    request->seq      = dev->disk.requestSeq++;
+    request->left     = request->right = NULL;
+    request->arrival  = systime();
+    request->deadline = request->arrival +
+                        (list == 0 ? DISK_READ_EXPIRE : DISK_WRITE_EXPIRE);
+    queue_append((queue_t**)&dev->disk.requestQueue, (queue_t*)request);
+    dev->disk.requestIndex = indexInsert(dev->disk.requestIndex, request);
+
+    request->expireNext = NULL;
+    request->expirePrev = dev->disk.expireTail[list];
+    if (dev->disk.expireTail[list]) {
+        dev->disk.expireTail[list]->expireNext = request;
+    } else {
+        dev->disk.expireHead[list] = request;
+    }
+    dev->disk.expireTail[list] = request;
+
+    flowPush(dev, flowOf(dev, request->task), request);
+}
+
+// Retira a requisição da fila e do índice (com a trava)
+static void queueRemove(disk_device_t* dev, diskrequest_t* request) {
+    queue_t* elem = (queue_t*)request;
+
+    if (elem->next == elem) {
+        dev->disk.requestQueue = NULL;
+    } else {
+        elem->prev->next = elem->next;
+        elem->next->prev = elem->prev;
+        if (dev->disk.requestQueue == request) {
+            dev->disk.requestQueue = (diskrequest_t*)elem->next;
+        }
+    }
+    elem->prev = elem->next = NULL;
+    dev->disk.requestIndex = indexRemove(dev->disk.requestIndex, request);
+
+    int list = EXPIRE_LIST(request);
+    if (request->expirePrev) {
+        request->expirePrev->expireNext = request->expireNext;
+    } else {
+        dev->disk.expireHead[list] = request->expireNext;
+    }
+    if (request->expireNext) {
+        request->expireNext->expirePrev = request->expirePrev;
+    } else {
+        dev->disk.expireTail[list] = request->expirePrev;
+    }
+    request->expirePrev = request->expireNext = NULL;
+
+    flowUnlink(dev, request);
+}
+
+/**
+ * Insere uma requisição na fila do disco
+ * 
+ * Só entra na fila: quem a atende é o gerente (ou um benchmark que chame
+ * disk_scheduler diretamente).
+ * 
+ * @param request Requisição pendente (fora de qualquer fila), do seu
+ *                disco ou, se não tem disco, do disco 0
+ */
+void disk_enqueue(diskrequest_t* request) {
+    disk_device_t* dev = request->device ? request->device : &devices[0];
+
+    sem_down(&dev->disk.semaforo_queue);
+    queueInsert(dev, request);
+    sem_up(&dev->disk.semaforo_queue);
+}
+
+/**
+ * Retira uma requisição da fila do disco
+ * 
+ * @param request Requisição presente na fila
+ */
+void disk_dequeue(diskrequest_t* request) {
+    disk_device_t* dev = request->device ? request->device : &devices[0];
+
+    sem_down(&dev->disk.semaforo_queue);
+    queueRemove(dev, request);
+    sem_up(&dev->disk.semaforo_queue);
+}
+
+/**
+ * Mostra a E/S feita pela tarefa que termina e libera a sua fila
+ * 
+ * Chamada em task_exit, com a preempção desabilitada, logo após a
+ * contabilização do processador: requisições atendidas pelo disco, bytes
+ * transferidos e soma das esperas (da fila à conclusão). Leituras
+ * atendidas pelo cache ou pela antecipação não contam; tarefas que não
+ * foram ao disco não mostram nada. Com vários discos, soma a E/S da
+ * tarefa em todos. Só marca as filas como livres, sem mexer nas tabelas;
+ * com operações assíncronas ainda na fila ou no disco, a fila é liberada
+ * na última conclusão.
+ * 
+ * @param task Tarefa que termina
+ */
+void disk_task_exit(task_t* task) {
+    disk_flow_t* flow;
+    unsigned int ops = 0, wait = 0;
+    unsigned long long bytes = 0;
+    int found = 0;
+    int i;
+
+    for (i = 0; i < DISK_MAX_DEVICES; i++) {
+        if (devices[i].kind != DEVICE_DISK || !(flow = flowFind(&devices[i], task->id))) {
+            continue;
+        }
+        found = 1;
+        ops   += flow->ops;
+        bytes += flow->bytes;
+        wait  += flow->wait;
+
+        if (flow->outstanding) {
+            flow->exited = 1;
+        } else {
+            flow->task_id = FLOW_FREE;
+        }
+    }
+
+    if (found) {
+        printf("Task %d exit: disk I/O %u ops, %llu bytes, wait time %u ms\n",
+               task->id, ops, bytes, wait);
+    }
+}
+
+
+/**
+ * ============================================================================
+ * ALGORITMOS DE ESCALONAMENTO
+ * ============================================================================
+ */
+
+/**
+ * Dispatcher principal dos algoritmos de escalonamento
+ * 
+ * Chama o algoritmo de escalonamento apropriado baseado na
+ * política atualmente ativa no disco.
+ * 
+ * @param dev Disco cuja fila é escalonada
+ * @return Ponteiro para próxima requisição a ser processada
+ */
+static diskrequest_t* deviceSchedule(disk_device_t* dev) {
+    switch (dev->perf_tracker.active_policy) {
+        case SCHEDULER_FCFS:
+            return fcfs_scheduler(dev);
+        case SCHEDULER_SSTF:
+            return sstf_scheduler(dev);
+        case SCHEDULER_CSCAN:
+        case SCHEDULER_CLOOK:
+            return cscan_scheduler(dev);
+        case SCHEDULER_SCAN:
+        case SCHEDULER_LOOK:
+            return elevator_scheduler(dev);
+        case SCHEDULER_DEADLINE:
+            return deadline_scheduler(dev);
+        case SCHEDULER_FAIR:
+            return fair_scheduler(dev);
+        default:
+            return fcfs_scheduler(dev);
+    }
+}
+
+/**
+ * Próxima requisição da fila do disco 0, pela política ativa
+ * 
+ * @return Ponteiro para próxima requisição a ser processada
+ */
+diskrequest_t* disk_scheduler(void) {
+    return deviceSchedule(&devices[0]);
+}
+
+/**
+ * Troca a política de escalonamento de um disco
+ * 
+ * Vale a partir da próxima requisição escolhida pelo gerente. Num disco
+ * em faixas, troca a de todos os membros.
+ * 
+ * @param id Número do disco
+ * @param policy SCHEDULER_FCFS, SCHEDULER_SSTF, SCHEDULER_CSCAN, SCHEDULER_SCAN,
+ *               SCHEDULER_LOOK, SCHEDULER_CLOOK, SCHEDULER_DEADLINE ou
+ *               SCHEDULER_FAIR
+ * @return 0 em sucesso, ERROR_INVALID se a política ou o disco não existe
+ */
+int disk_set_scheduler_dev(int id, int policy) {
+    disk_device_t* dev = deviceOf(id);
+    int i;
+
+    if (!dev || policy < SCHEDULER_FCFS || policy > SCHEDULER_FAIR) {
+        return ERROR_INVALID;
+    }
+
+    if (dev->kind == DEVICE_STRIPE) {
+        for (i = 0; i < dev->numMembers; i++) {
+            disk_set_scheduler_dev(dev->members[i], policy);
+        }
+        return 0;
+    }
+
+    dev->perf_tracker.active_policy = policy;
+    return 0;
+}
+
+int disk_set_scheduler(int policy) {
+    return disk_set_scheduler_dev(0, policy);
+}
+
+/**
+ * Escolhe como o cache trata as escritas
+ * 
+ * Vale para os discos inicializados depois da chamada (disk_mgr_init e
+ * disk_dev_init); os já abertos mantêm o modo com que começaram.
+ * DISK_CACHE_WRITE é só o padrão.
+ * 
+ * @param mode DISK_WRITE_THROUGH ou DISK_WRITE_BACK
+ * @return 0 em sucesso, ERROR_INVALID se o modo não existe
+ */
+int disk_set_cache_write(int mode) {
+    if (mode != DISK_WRITE_THROUGH && mode != DISK_WRITE_BACK) {
+        return ERROR_INVALID;
+    }
+
+    cacheWriteMode = mode;
+    return 0;
+}
+
+/**
+ * Algoritmo FCFS - First Come, First Served
+ * 
+ * Implementa escalonamento simples: primeira requisição que
+ * chegou é a primeira a ser atendida.
+ * 
+ * @return Ponteiro para primeira requisição da fila
+ */
+static diskrequest_t* fcfs_scheduler(disk_device_t* dev) {
+    return (diskrequest_t*)dev->disk.requestQueue;
+}
+
+/**
+ * Algoritmo SSTF - Shortest Seek Time First
+ * 
+ * Seleciona a requisição que requer menor movimento da cabeça
+ * do disco a partir da posição atual: a mais próxima entre o teto e o
+ * piso da cabeça no índice, em O(log n).
+ * 
+ * @return Ponteiro para requisição com menor distância de seek
+ */
+static diskrequest_t* sstf_scheduler(disk_device_t* dev) {
+    if (!dev->disk.requestQueue) return NULL;
+
+    int head = dev->perf_tracker.current_head_position;
+
+    // Vizinhas da cabeça no índice: a partir dela e logo abaixo dela
+    diskrequest_t* above = indexCeiling(dev, head, 0);
+    diskrequest_t* below = indexFloor(dev, head);
+
+    if (!above || !below) {
+        return indexPick(dev, (above ? above : below)->block);
+    }
+
+    int distance_above = above->block - head;
+    int distance_below = head - below->block;
+
+    if (distance_above != distance_below) {
+        return indexPick(dev, (distance_above < distance_below) ? above->block : below->block);
+    }
+
+    // Empate entre os dois lados: mesmo critério de indexPick
+    diskrequest_t* oldest = dev->disk.requestQueue;
+    if (oldest->block == above->block || oldest->block == below->block) {
+        return oldest;
+    }
+    above = indexFloor(dev, above->block + 1);
+    return (above->seq > below->seq) ? above : below;
+}
+
+/**
+ * Algoritmos CSCAN - Circular Scan e C-LOOK
+ * 
+ * Move a cabeça sempre em direção crescente. Quando chega ao fim,
+ * retorna ao início do disco (movimento circular): o sucessor da cabeça
+ * no índice ou, sem ele, o menor bloco, em O(log n). As duas políticas
+ * escolhem a mesma requisição; diferem no caminho da cabeça na volta
+ * (ver headMovement): o CSCAN vai até o último bloco e volta ao bloco 0,
+ * o C-LOOK salta da última requisição direto para a primeira.
+ * 
+ * @return Ponteiro para próxima requisição na direção crescente
+ */
+static diskrequest_t* cscan_scheduler(disk_device_t* dev) {
+    if (!dev->disk.requestQueue) return NULL;
+
+    // Primeira a partir da cabeça; senão volta ao início do disco
+    diskrequest_t* forward = indexCeiling(dev, dev->perf_tracker.current_head_position, 0);
+    dev->perf_tracker.turned = !forward;
+    if (!forward) {
+        forward = indexCeiling(dev, 0, 0);
+    }
+    return indexPick(dev, forward->block);
+}
+
+/**
+ * Algoritmos SCAN (elevador) e LOOK
+ * 
+ * Atende as requisições no sentido atual da varredura, a partir da
+ * cabeça; sem nenhuma nesse sentido, inverte-o. As duas políticas
+ * escolhem a mesma requisição; diferem no caminho da cabeça ao inverter
+ * (ver headMovement): o SCAN vai até a borda do disco, o LOOK inverte
+ * já na última requisição.
+ * 
+ * @return Ponteiro para próxima requisição no sentido da varredura
+ */
+static diskrequest_t* elevator_scheduler(disk_device_t* dev) {
+    if (!dev->disk.requestQueue) return NULL;
+
+    int head = dev->perf_tracker.current_head_position;
+    diskrequest_t* next = (dev->perf_tracker.last_direction > 0) ? indexCeiling(dev, head, 0)
+                                                            : indexFloor(dev, head + 1);
+
+    dev->perf_tracker.turned = !next;
+    if (!next) {
+        dev->perf_tracker.last_direction = -dev->perf_tracker.last_direction;
+        next = (dev->perf_tracker.last_direction > 0) ? indexCeiling(dev, head, 0)
+                                                 : indexFloor(dev, head + 1);
+    }
+    return indexPick(dev, next->block);
+}
+
+/**
+ * Algoritmo DEADLINE
+ * 
+ * Atende pela ordem de bloco a mais próxima da cabeça, como o SSTF, mas
+ * cada requisição tem um prazo (DISK_READ_EXPIRE ou DISK_WRITE_EXPIRE ms
+ * após a chegada): se a mais antiga de leitura ou a de escrita já venceu,
+ * ela é atendida primeiro (a de prazo menor, se as duas venceram). Assim
+ * nenhuma requisição espera indefinidamente longe da cabeça, o que pode
+ * acontecer com o SSTF.
+ * 
+ * @return Ponteiro para a requisição vencida ou a próxima por bloco
+ */
+static diskrequest_t* deadline_scheduler(disk_device_t* dev) {
+    if (!dev->disk.requestQueue) return NULL;
+
+    unsigned int now = systime();
+    diskrequest_t* read  = dev->disk.expireHead[0];
+    diskrequest_t* write = dev->disk.expireHead[1];
+    diskrequest_t* expired = NULL;
+
+    // Prazos comparados pela diferença, que vale mesmo se o relógio der a volta
+    if (read && (int)(now - read->deadline) >= 0) {
+        expired = read;
+    }
+    if (write && (int)(now - write->deadline) >= 0 &&
+        (!expired || (int)(write->deadline - expired->deadline) < 0)) {
+        expired = write;
+    }
+    if (expired) {
+        dev->perf_tracker.expired_served++;
+        return expired;
+    }
+
+    return sstf_scheduler(dev);
+}
+
+/**
+ * Algoritmo FAIR - filas por tarefa atendidas em fatias ponderadas
+ * 
+ * Cada tarefa tem a sua fila de pendentes, com peso vindo de
+ * task_getprio() da dona (FLOW_WEIGHT). A fila da vez é atendida em ordem
+ * de chegada até esvaziar, gastar DISK_FAIR_BUDGET blocos ou passar
+ * DISK_FAIR_SLICE ms; então a vez passa à de menor tempo virtual, que
+ * avança FLOW_SCALE / peso a cada bloco atendido. Assim o disco é
+ * dividido entre as tarefas na proporção dos pesos, por mais requisições
+ * que uma delas faça ou por mais perto da cabeça que elas estejam. Para
+ * não perder toda a localidade, entre as filas até FLOW_WINDOW atrás da
+ * menor vai a cuja primeira requisição está mais perto da cabeça.
+ * 
+ * @return Ponteiro para a primeira requisição da fila da vez
+ */
+static diskrequest_t* fair_scheduler(disk_device_t* dev) {
+    if (!dev->disk.requestQueue) return NULL;
+
+    unsigned int now = systime();
+    disk_flow_t* flow = dev->fair.active;
+
+    // Fatia esgotada ou fila vazia: a vez passa a outra fila
+    if (!flow || !flow->pending || dev->fair.budget <= 0 || (int)(now - dev->fair.sliceEnd) >= 0) {
+        int head = dev->perf_tracker.current_head_position;
+        unsigned long long least = dev->fair.backlog->vtime;
+        disk_flow_t* f;
+
+        for (f = dev->fair.backlog; f; f = f->bnext) {
+            if (f->vtime < least) {
+                least = f->vtime;
+            }
+        }
+
+        // Entre as que estão até FLOW_WINDOW da menor, a mais perto da cabeça
+        flow = NULL;
+        for (f = dev->fair.backlog; f; f = f->bnext) {
+            if (f->vtime - least <= FLOW_WINDOW &&
+                (!flow || abs(f->head->block - head) < abs(flow->head->block - head))) {
+                flow = f;
+            }
+        }
+
+        dev->fair.active   = flow;
+        dev->fair.budget   = DISK_FAIR_BUDGET;
+        dev->fair.sliceEnd = now + DISK_FAIR_SLICE;
+        dev->fair.vtime    = least;
+        dev->fair.slices++;
+    }
+
+    diskrequest_t* request = flow->head;
+    flow->vtime += (unsigned long long)request->count * FLOW_SCALE / flow->weight;
+    dev->fair.budget -= request->count;
+
+    return request;
+}
+
+
+/**
+ * ============================================================================
+ * CACHE DE BLOCOS
+ * ============================================================================
+ */
+
+/*
+ * Cache com tabela hash por número de bloco. Leituras que acertam são
+ * atendidas na própria tarefa; o gerente insere cada bloco lido ou escrito
+ * ao concluir a operação. As listas são compartilhadas entre as tarefas e
+ * o gerente, então toda operação roda com a preempção desabilitada (são
+ * curtas: uma cópia de bloco e ajustes de ponteiros).
+ *
+ * LRU: t1 guarda os blocos do mais antigo ao mais recente.
+ * ARC: t1 guarda blocos vistos uma vez e t2 os vistos mais vezes; b1 e b2
+ * lembram só os números dos blocos retirados de t1 e t2. Uma falta em b1
+ * indica que t1 deveria ser maior e aumenta o alvo p; uma falta em b2 o
+ * diminui (Megiddo e Modha, 2003).
+ *
+ * Write-back: a escrita só atualiza o bloco no cache e o marca sujo. O
+ * gerente grava os sujos em ordem de elevador (cópias em requisições sem
+ * dona) com o disco ocioso, acima do limite de sujos, em disk_sync() e no
+ * encerramento. Blocos sujos ou sendo gravados não saem do cache, então
+ * uma leitura nunca vai ao disco buscar um conteúdo mais velho que o seu;
+ * sem bloco limpo para substituir, a escrita vira write-through.
+ */
+
+// Balde da tabela hash de um bloco
+static unsigned int cacheHash(disk_device_t* dev, int block) {
+    return ((unsigned int)block * 2654435761u) & dev->cache.mask;
+}
+
+// Procura a entrada (com dados ou fantasma) de um bloco
+static cache_entry_t* cacheFind(disk_device_t* dev, int block) {
+    cache_entry_t* entry = dev->cache.buckets[cacheHash(dev, block)];
+
+    while (entry && entry->block != block) {
+        entry = entry->hnext;
+    }
+    return entry;
+}
+
+// Retira a entrada da sua lista
+static void listRemove(cache_entry_t* entry) {
+    cache_list_t* list = entry->list;
+
+    if (entry->prev) entry->prev->next = entry->next;
+    else             list->lru = entry->next;
+    if (entry->next) entry->next->prev = entry->prev;
+    else             list->mru = entry->prev;
+
+    entry->prev = entry->next = NULL;
+    entry->list = NULL;
+    list->size--;
+}
+
+// Coloca a entrada como a mais recente da lista
+static void listPushMru(cache_list_t* list, cache_entry_t* entry) {
+    entry->prev = list->mru;
+    entry->next = NULL;
+    if (list->mru) list->mru->next = entry;
+    else           list->lru = entry;
+    list->mru = entry;
+    entry->list = list;
+    list->size++;
+}
+
+// Move a entrada para o fim (mais recente) de uma lista
+static void listMoveMru(cache_list_t* list, cache_entry_t* entry) {
+    listRemove(entry);
+    listPushMru(list, entry);
+}
+
+// Entrada mais antiga da lista que pode sair do cache (limpa e sem gravação)
+static cache_entry_t* listOldestClean(cache_list_t* list) {
+    cache_entry_t* entry = list->lru;
+
+    while (entry && (entry->dirty || entry->flushing)) {
+        entry = entry->next;
+    }
+    return entry;
+}
+
+// Tira a entrada da tabela hash
+static void cacheUnhash(disk_device_t* dev, cache_entry_t* entry) {
+    cache_entry_t** link = &dev->cache.buckets[cacheHash(dev, entry->block)];
+
+    while (*link != entry) {
+        link = &(*link)->hnext;
+    }
+    *link = entry->hnext;
+}
+
+// Pega uma entrada livre para um bloco novo e a coloca na tabela e na lista
+static cache_entry_t* cacheInsert(disk_device_t* dev, cache_list_t* list, int block) {
+    cache_entry_t* entry = dev->cache.freeEntries;
+    unsigned int h = cacheHash(dev, block);
+
+    dev->cache.freeEntries = entry->hnext;
+    entry->block = block;
+    entry->hnext = dev->cache.buckets[h];
+    dev->cache.buckets[h] = entry;
+    listPushMru(list, entry);
+    return entry;
+}
+
+// Descarta a entrada, devolvendo entrada e buffer
+static void cacheDiscard(disk_device_t* dev, cache_entry_t* entry) {
+    listRemove(entry);
+    cacheUnhash(dev, entry);
+    if (entry->data) {
+        dev->cache.freeData[dev->cache.numFreeData++] = entry->data;
+        entry->data = NULL;
+    }
+    entry->hnext = dev->cache.freeEntries;
+    dev->cache.freeEntries = entry;
+}
+
+/**
+ * Libera um buffer retirando um bloco limpo de t1 ou t2 (REPLACE da ARC)
+ * 
+ * O bloco retirado vira fantasma em b1 ou b2. Se a lista escolhida só
+ * tiver blocos sujos, tenta a outra.
+ * 
+ * @param inB2 O bloco procurado estava em b2
+ * @return 1 se há buffer livre, 0 se todos os blocos estão sujos
+ */
+static int cacheReplace(disk_device_t* dev, int inB2) {
+    cache_list_t *from, *ghost;
+    cache_entry_t* victim;
+
+    if (dev->cache.t1.size + dev->cache.t2.size < dev->cache.capacity) {
+        return 1;   // ainda há buffers livres
+    }
+
+    if (dev->cache.t1.size > 0 &&
+        ((inB2 && dev->cache.t1.size == dev->cache.target) || dev->cache.t1.size > dev->cache.target ||
+         dev->cache.t2.size == 0)) {
+        from = &dev->cache.t1;  ghost = &dev->cache.b1;
+    } else {
+        from = &dev->cache.t2;  ghost = &dev->cache.b2;
+    }
+
+    victim = listOldestClean(from);
+    if (!victim) {
+        from  = (from == &dev->cache.t1) ? &dev->cache.t2 : &dev->cache.t1;
+        ghost = (from == &dev->cache.t1) ? &dev->cache.b1 : &dev->cache.b2;
+        victim = listOldestClean(from);
+        if (!victim) {
+            return 0;
+        }
+    }
+
+    listMoveMru(ghost, victim);
+    dev->cache.freeData[dev->cache.numFreeData++] = victim->data;
+    victim->data = NULL;
+    dev->cache.evictions++;
+    return 1;
+}
+
+/**
+ * Obtém a entrada com dados de um bloco, abrindo espaço se preciso
+ * 
+ * Conta como um acesso ao bloco para a política de substituição.
+ * 
+ * @param block Número do bloco
+ * @return Entrada com buffer, ou NULL se não há bloco limpo para substituir
+ */
+static cache_entry_t* cacheInstall(disk_device_t* dev, int block) {
+    cache_entry_t* entry = cacheFind(dev, block);
+    cache_entry_t* victim;
+    int c = dev->cache.capacity;
+
+    if (entry && entry->data) {
+        // Bloco já em cache: na ARC o segundo uso o torna frequente
+        listMoveMru(dev->cache.policy == DISK_CACHE_ARC ? &dev->cache.t2 : &dev->cache.t1, entry);
+        return entry;
+    }
+
+    if (dev->cache.policy == DISK_CACHE_LRU) {
+        if (dev->cache.t1.size == c) {
+            if (!(victim = listOldestClean(&dev->cache.t1))) {
+                return NULL;
+            }
+            cacheDiscard(dev, victim);
+            dev->cache.evictions++;
+        }
+        entry = cacheInsert(dev, &dev->cache.t1, block);
+    }
+    else if (entry) {
+        // Fantasma: o bloco saiu cedo demais; ajusta o alvo de t1
+        int b1 = dev->cache.b1.size, b2 = dev->cache.b2.size;
+        int inB2 = (entry->list == &dev->cache.b2);
+
+        if (!inB2) {
+            dev->cache.target += (b2 / b1 > 1) ? b2 / b1 : 1;
+            if (dev->cache.target > c) dev->cache.target = c;
+        } else {
+            dev->cache.target -= (b1 / b2 > 1) ? b1 / b2 : 1;
+            if (dev->cache.target < 0) dev->cache.target = 0;
+        }
+        if (!cacheReplace(dev, inB2)) {
+            return NULL;
+        }
+        listMoveMru(&dev->cache.t2, entry);
+        dev->cache.ghost_hits++;
+    }
+    else {
+        // Bloco novo: abre espaço mantendo |t1|+|b1| <= c e o total <= 2c
+        int total = dev->cache.t1.size + dev->cache.t2.size + dev->cache.b1.size + dev->cache.b2.size;
+
+        if (dev->cache.t1.size + dev->cache.b1.size == c) {
+            if (dev->cache.t1.size < c) {
+                cacheDiscard(dev, dev->cache.b1.lru);
+                if (!cacheReplace(dev, 0)) {
+                    return NULL;
+                }
+            } else {
+                if (!(victim = listOldestClean(&dev->cache.t1))) {
+                    return NULL;
+                }
+                cacheDiscard(dev, victim);
+                dev->cache.evictions++;
+            }
+        } else if (total >= c) {
+            if (total == 2 * c) {
+                cacheDiscard(dev, dev->cache.b2.lru);
+            }
+            if (!cacheReplace(dev, 0)) {
+                return NULL;
+            }
+        }
+        entry = cacheInsert(dev, &dev->cache.t1, block);
+    }
+
+    // Entrada nova ou que era fantasma: recebe um buffer livre
+    entry->data = dev->cache.freeData[--dev->cache.numFreeData];
+    return entry;
+}
+
+/**
+ * Inicializa o cache de blocos
+ * 
+ * @param capacity Número de blocos com dados (0 desativa o cache)
+ * @param blockSize Tamanho de cada bloco em bytes
+ * @return 0 em sucesso, ERROR_INVALID se faltar memória
+ */
+static int cacheInit(disk_device_t* dev, int capacity, int blockSize) {
+    int entries = 2 * capacity;     // com dados + fantasmas (ARC)
+    unsigned int buckets = 1;
+    int i;
+
+    memset(&dev->cache, 0, sizeof(dev->cache));
+    dev->cache.policy = DISK_CACHE_POLICY;
+    if (capacity <= 0) {
+        return 0;
+    }
+
+    while (buckets < (unsigned int)entries) {
+        buckets <<= 1;
+    }
+
+    cache_entry_t* pool = calloc(entries, sizeof(cache_entry_t));
+    char* data          = malloc((size_t)capacity * blockSize);
+    dev->cache.buckets       = calloc(buckets, sizeof(cache_entry_t*));
+    dev->cache.freeData      = malloc(capacity * sizeof(char*));
+    dev->cache.batch         = malloc(capacity * sizeof(diskrequest_t*));
+    if (!pool || !data || !dev->cache.buckets || !dev->cache.freeData || !dev->cache.batch) {
+        free(pool);
+        free(data);
+        free(dev->cache.buckets);
+        free(dev->cache.freeData);
+        free(dev->cache.batch);
+        return ERROR_INVALID;
+    }
+
+    for (i = 0; i < entries; i++) {
+        pool[i].hnext = dev->cache.freeEntries;
+        dev->cache.freeEntries = &pool[i];
+    }
+    for (i = 0; i < capacity; i++) {
+        dev->cache.freeData[dev->cache.numFreeData++] = data + (size_t)i * blockSize;
+    }
+
+    dev->cache.mask       = buckets - 1;
+    dev->cache.capacity   = capacity;
+    dev->cache.writeBack  = (cacheWriteMode == DISK_WRITE_BACK);
+    dev->cache.dirtyLimit = (DISK_CACHE_DIRTY_MAX > 0 && DISK_CACHE_DIRTY_MAX < capacity)
+                     ? DISK_CACHE_DIRTY_MAX : capacity;
+    sem_create(&dev->cache.synced, 0);
+    return 0;
+}
+
+/**
+ * Procura um bloco no cache e, se presente, copia-o para o buffer
+ * 
+ * @param block Número do bloco
+ * @param buffer Destino dos dados
+ * @return 1 em acerto, 0 em falta (a leitura deve ir ao disco)
+ */
+static int cacheLookup(disk_device_t* dev, int block, void* buffer) {
+    int hit = 0;
+
+    if (dev->cache.capacity == 0) {
+        return 0;
+    }
+
+    PPOS_PREEMPT_DISABLE;
+
+    cache_entry_t* entry = cacheFind(dev, block);
+    if (entry && entry->data) {
+        memcpy(buffer, entry->data, dev->disk.blockSize);
+
+        // Segundo uso: na ARC o bloco passa a frequente
+        listMoveMru(dev->cache.policy == DISK_CACHE_ARC ? &dev->cache.t2 : &dev->cache.t1, entry);
+        dev->cache.hits++;
+        hit = 1;
+    } else {
+        dev->cache.misses++;
+    }
+
+    PPOS_PREEMPT_ENABLE;
+    return hit;
+}
+
+/**
+ * Copia um intervalo de blocos do cache, se todos estiverem presentes
+ * 
+ * @param block Primeiro bloco
+ * @param count Número de blocos
+ * @param buffer Destino contínuo dos dados
+ * @return 1 se todos acertaram, 0 se o intervalo deve ir ao disco
+ */
+static int cacheLookupRange(disk_device_t* dev, int block, int count, char* buffer) {
+    cache_entry_t* entry;
+    int k, hit = 1;
+
+    if (dev->cache.capacity == 0) {
+        return 0;
+    }
+
+    PPOS_PREEMPT_DISABLE;
+
+    for (k = 0; k < count && hit; k++) {
+        entry = cacheFind(dev, block + k);
+        hit = entry && entry->data;
+    }
+
+    if (hit) {
+        for (k = 0; k < count; k++) {
+            entry = cacheFind(dev, block + k);
+            memcpy(buffer + (size_t)k * dev->disk.blockSize, entry->data, dev->disk.blockSize);
+            listMoveMru(dev->cache.policy == DISK_CACHE_ARC ? &dev->cache.t2 : &dev->cache.t1, entry);
+        }
+        dev->cache.hits += count;
+    } else {
+        dev->cache.misses += count;
+    }
+
+    PPOS_PREEMPT_ENABLE;
+    return hit;
+}
+
+// Algum bloco do intervalo está sujo ou sendo gravado? (preempção desabilitada)
+static int cacheHasDirty(disk_device_t* dev, int block, int count) {
+    cache_entry_t* entry;
+    int k;
+
+    for (k = 0; k < count && dev->cache.dirty + dev->cache.flushing > 0; k++) {
+        entry = cacheFind(dev, block + k);
+        if (entry && (entry->dirty || entry->flushing)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Registra no cache o conteúdo de um bloco lido ou escrito no disco
+ * 
+ * Uma leitura não sobrescreve um bloco sujo ou sendo gravado: o cache
+ * já tem um conteúdo mais novo que o lido do disco.
+ * 
+ * @param block Número do bloco
+ * @param data Conteúdo atual do bloco no disco
+ * @param isRead A operação concluída foi uma leitura
+ */
+static void cacheUpdate(disk_device_t* dev, int block, void* data, int isRead) {
+    cache_entry_t* entry;
+
+    if (dev->cache.capacity == 0) {
+        return;
+    }
+
+    PPOS_PREEMPT_DISABLE;
+
+    entry = cacheFind(dev, block);
+    if (!(isRead && entry && (entry->dirty || entry->flushing))) {
+        entry = cacheInstall(dev, block);
+        if (entry) {
+            memcpy(entry->data, data, dev->disk.blockSize);
+        }
+    }
+
+    PPOS_PREEMPT_ENABLE;
+}
+
+/**
+ * Escrita em write-back: atualiza o bloco no cache e o marca sujo
+ * 
+ * @param block Número do bloco
+ * @param data Novo conteúdo
+ * @return 1 se a escrita ficou no cache, 0 se deve ir ao disco
+ */
+static int cacheWrite(disk_device_t* dev, int block, void* data) {
+    cache_entry_t* entry;
+
+    if (!dev->cache.writeBack) {
+        return 0;
+    }
+
+    PPOS_PREEMPT_DISABLE;
+
+    entry = cacheInstall(dev, block);
+    if (entry) {
+        memcpy(entry->data, data, dev->disk.blockSize);
+        if (!entry->dirty) {
+            entry->dirty = 1;
+            dev->cache.dirty++;
+            if (!entry->flushing) {
+                dev->cache.toFlush++;
+            }
+        }
+        dev->cache.write_hits++;
+    }
+
+    PPOS_PREEMPT_ENABLE;
+    return entry != NULL;
+}
+
+// Há blocos sujos a gravar, vaga no pool e motivo para gravá-los agora?
+static int cacheFlushDue(disk_device_t* dev) {
+    return dev->cache.toFlush > 0 && requestPool.free &&
+           (dev->cache.syncWaiters > 0 || system_shutdown_requested ||
+            dev->cache.dirty >= dev->cache.dirtyLimit || (dev->disk.livre && !dev->disk.requestQueue));
+}
+
+// Ordem de elevador: pela distância à frente da cabeça, guardada em seq
+// até a requisição entrar na fila (o qsort não leva o disco ao comparador)
+static int compareElevator(const void* a, const void* b) {
+    unsigned int da = (*(diskrequest_t**)a)->seq;
+    unsigned int db = (*(diskrequest_t**)b)->seq;
+
+    return (da > db) - (da < db);
+}
+
+/**
+ * Grava os blocos sujos no disco (executado pelo gerente)
+ * 
+ * Cada bloco é copiado para uma requisição sem dona, para que novas
+ * escritas no cache não alterem o que está sendo gravado; um bloco com
+ * gravação em andamento espera ela terminar antes de ser gravado de novo.
+ */
+static void processWriteBack(disk_device_t* dev) {
+    diskrequest_t** batch = dev->cache.batch;
+    cache_entry_t* entry;
+    cache_list_t* lists[2] = { &dev->cache.t1, &dev->cache.t2 };
+    int i, n = 0;
+
+    if (!cacheFlushDue(dev)) {
+        return;
+    }
+
+    PPOS_PREEMPT_DISABLE;
+
+    for (i = 0; i < 2; i++) {
+        for (entry = lists[i]->lru; entry; entry = entry->next) {
+            if (!entry->dirty || entry->flushing) {
+                continue;
+            }
+
+            diskrequest_t* request = requestAlloc();   // o gerente não espera vaga
+            if (!request) {
+                break;
+            }
+            request->prev = request->next = NULL;
+            request->task      = NULL;              // escrita de volta: sem dona
+            request->operation = DISK_CMD_WRITE;
+            request->block     = entry->block;
+            request->count     = 1;
+            request->buffer    = request + 1;       // cópia no espaço da vaga
+            request->one.iov_base = request->buffer;
+            request->one.iov_len  = dev->disk.blockSize;
+            request->iov       = &request->one;
+            request->iovcnt    = 1;
+            request->merged    = NULL;
+            request->status    = 0;
+            request->finished  = 0;
+            request->device    = dev;
+            request->seq       = (entry->block - dev->perf_tracker.current_head_position +
+                                  dev->disk.numBlocks) % dev->disk.numBlocks;
+            memcpy(request->buffer, entry->data, dev->disk.blockSize);
+
+            entry->dirty    = 0;
+            entry->flushing = 1;
+            dev->cache.dirty--;
+            dev->cache.toFlush--;
+            dev->cache.flushing++;
+            dev->cache.writebacks++;
+            batch[n++] = request;
+        }
+    }
+
+    PPOS_PREEMPT_ENABLE;
+
+    // Entram na fila já em ordem de elevador (vale também com FCFS)
+    qsort(batch, n, sizeof(diskrequest_t*), compareElevator);
+
+    sem_down(&dev->disk.semaforo_queue);
+    for (i = 0; i < n; i++) {
+        queueInsert(dev, batch[i]);
+    }
+    sem_up(&dev->disk.semaforo_queue);
+}
+
+/**
+ * Conclusão de uma escrita de volta (executado pelo gerente)
+ * 
+ * @param request Requisição sem dona criada por processWriteBack
+ * @param status 0 em sucesso; em erro o bloco volta a ficar sujo
+ */
+static void cacheFlushDone(disk_device_t* dev, diskrequest_t* request, int status) {
+    PPOS_PREEMPT_DISABLE;
+
+    cache_entry_t* entry = cacheFind(dev, request->block);   // presa no cache
+    entry->flushing = 0;
+    dev->cache.flushing--;
+    if (status < 0 && !entry->dirty) {
+        entry->dirty = 1;
+        dev->cache.dirty++;
+    }
+    if (entry->dirty) {
+        dev->cache.toFlush++;
+    }
+
+    PPOS_PREEMPT_ENABLE;
+
+    requestFree(request);
+}
+
+// Acorda as tarefas em disk_sync() se nada mais falta gravar
+static void cacheWakeSyncers(disk_device_t* dev) {
+    int waiters = 0;
+
+    PPOS_PREEMPT_DISABLE;
+    if (dev->cache.dirty == 0 && dev->cache.flushing == 0) {
+        waiters = dev->cache.syncWaiters;
+        dev->cache.syncWaiters = 0;
+    }
+    PPOS_PREEMPT_ENABLE;
+
+    while (waiters-- > 0) {
+        sem_up(&dev->cache.synced);
+    }
+}
+
+/**
+ * Espera até que todos os blocos sujos estejam gravados no disco
+ * 
+ * Em write-through retorna de imediato. Com outras tarefas escrevendo
+ * ao mesmo tempo, espera também pelos blocos que elas sujarem. Num disco
+ * em faixas, espera os sujos de cada membro.
+ * 
+ * @param id Número do disco
+ * @return 0, ou ERROR_INVALID se o disco não existe
+ */
+int disk_sync_dev(int id) {
+    disk_device_t* dev = deviceOf(id);
+    int i;
+
+    if (dev && dev->kind == DEVICE_STRIPE) {
+        for (i = 0; i < dev->numMembers; i++) {
+            disk_sync_dev(dev->members[i]);
+        }
+        return 0;
+    }
+    if (!dev) {
+        return ERROR_INVALID;
+    }
+    if (!dev->cache.writeBack) {
+        return 0;
+    }
+
+    PPOS_PREEMPT_DISABLE;
+    if (dev->cache.dirty == 0 && dev->cache.flushing == 0) {
+        PPOS_PREEMPT_ENABLE;
+        return 0;
+    }
+    dev->cache.syncWaiters++;
+    PPOS_PREEMPT_ENABLE;
+
+    wakeDiskManager(dev);
+    sem_down(&dev->cache.synced);
+    return 0;
+}
+
+int disk_sync(void) {
+    disk_sync_dev(0);
+    return 0;
+}
+
+
+/**
+ * ============================================================================
+ * LEITURA ANTECIPADA
+ * ============================================================================
+ */
+
+/*
+ * Cada tarefa que lê blocos em sequência tem um fluxo. Depois de
+ * DISK_RA_TRIGGER leituras consecutivas, o fluxo pede a leitura dos
+ * próximos blocos (a janela) para um segmento próprio; o gerente só a
+ * envia com o disco ocioso e a fila vazia, como uma requisição sem dona
+ * de um intervalo inteiro. Ao começar a consumir um segmento, o fluxo já
+ * pede o seguinte no outro, com a janela dobrada até DISK_RA_MAX. Uma
+ * leitura fora da sequência cancela o fluxo e a janela volta ao mínimo;
+ * escritas invalidam os segmentos com os blocos escritos.
+ *
+ * Os fluxos são compartilhados entre as tarefas e o gerente: como no
+ * cache, o estado só muda com a preempção desabilitada.
+ */
+
+// Pede a leitura antecipada da janela a partir de start no segmento livre
+static void raRequest(disk_device_t* dev, ra_stream_t* s, int start) {
+    ra_segment_t* seg;
+    int i;
+
+    if (start >= dev->disk.numBlocks) {
+        return;
+    }
+    for (i = 0; i < 2; i++) {
+        seg = &s->seg[i];
+        if (seg->state == RA_EMPTY) {
+            seg->state     = RA_WANTED;
+            seg->start     = start;
+            seg->count     = (dev->disk.numBlocks - start < s->window) ? dev->disk.numBlocks - start
+                                                                  : s->window;
+            seg->cancelled = 0;
+            s->window = (s->window * 2 < DISK_RA_MAX) ? s->window * 2 : DISK_RA_MAX;
+            wakeDiskManager(dev);
+            return;
+        }
+    }
+}
+
+// Descarta os segmentos do fluxo (os pendentes, ao concluir)
+static int raCancel(ra_stream_t* s) {
+    int i, dropped = 0;
+
+    for (i = 0; i < 2; i++) {
+        ra_segment_t* seg = &s->seg[i];
+        if (seg->state == RA_PENDING) {
+            dropped += !seg->cancelled;
+            seg->cancelled = 1;
+        } else if (seg->state != RA_EMPTY) {
+            seg->state = RA_EMPTY;
+            dropped++;
+        }
+    }
+    return dropped;
+}
+
+// Fluxo da tarefa, criado (reaproveitando o mais antigo livre) se preciso
+static ra_stream_t* raStreamOf(disk_device_t* dev, int task_id) {
+    ra_stream_t *s, *oldest = NULL;
+    int i;
+
+    for (i = 0; i < DISK_RA_STREAMS; i++) {
+        if (dev->streams[i].task_id == task_id) {
+            return &dev->streams[i];
+        }
+    }
+
+    // Um fluxo com segmento pendente ou dona esperando não pode ser trocado
+    for (i = 0; i < DISK_RA_STREAMS; i++) {
+        s = &dev->streams[i];
+        if (s->waiting || s->seg[0].state == RA_PENDING || s->seg[1].state == RA_PENDING) {
+            continue;
+        }
+        if (!oldest || s->task_id < 0 || (oldest->task_id >= 0 && s->last_use < oldest->last_use)) {
+            oldest = s;
+        }
+    }
+
+    if (oldest) {
+        raCancel(oldest);
+        oldest->task_id = task_id;
+        oldest->next    = -1;
+        oldest->run     = 0;
+        oldest->window  = DISK_RA_MIN;
+    }
+    return oldest;
+}
+
+/**
+ * Inicializa os fluxos de leitura antecipada
+ * 
+ * @param blockSize Tamanho de cada bloco em bytes
+ */
+static void raInit(disk_device_t* dev, int blockSize) {
+    int i, j;
+
+    dev->raEnabled = (DISK_RA_MAX > 0);
+    for (i = 0; i < DISK_RA_STREAMS && dev->raEnabled; i++) {
+        memset(&dev->streams[i], 0, sizeof(ra_stream_t));
+        dev->streams[i].task_id = -1;
+        sem_create(&dev->streams[i].ready, 0);
+        for (j = 0; j < 2; j++) {
+            dev->streams[i].seg[j].data = malloc((size_t)DISK_RA_MAX * blockSize);
+            if (!dev->streams[i].seg[j].data) {
+                dev->raEnabled = 0;      // sem memória, o gerente segue sem antecipar
+            }
+        }
+    }
+}
+
+/**
+ * Atende uma leitura pelo fluxo da tarefa, se o bloco foi antecipado
+ * 
+ * Se o bloco estiver num segmento ainda sendo lido, espera por ele.
+ * Senão, registra a leitura na sequência do fluxo (ou o cancela) e,
+ * depois de DISK_RA_TRIGGER leituras consecutivas, pede a antecipação.
+ * 
+ * @param block Número do bloco
+ * @param buffer Destino dos dados
+ * @return 1 se o bloco foi copiado, 0 se a leitura deve ir ao disco
+ */
+static int raRead(disk_device_t* dev, int block, void* buffer) {
+    ra_stream_t* s;
+    ra_segment_t* seg;
+    int i;
+
+    if (!dev->raEnabled) {
+        return 0;
+    }
+
+    PPOS_PREEMPT_DISABLE;
+
+    s = raStreamOf(dev, taskExec->id);
+    while (s) {
+        s->last_use = systime();
+
+        for (i = 0, seg = NULL; i < 2 && !seg; i++) {
+            ra_segment_t* candidate = &s->seg[i];
+            if (candidate->state != RA_EMPTY && !candidate->cancelled &&
+                block >= candidate->start && block < candidate->start + candidate->count) {
+                seg = candidate;
+            }
+        }
+
+        if (!seg) {
+            break;
+        }
+
+        // Ainda sendo lido: espera a conclusão e procura de novo
+        if (seg->state != RA_READY) {
+            s->waiting = 1;
+            dev->perf_tracker.ra_waits++;
+            PPOS_PREEMPT_ENABLE;
+            sem_down(&s->ready);
+            PPOS_PREEMPT_DISABLE;
+            continue;
+        }
+
+        memcpy(buffer, seg->data + (size_t)(block - seg->start) * dev->disk.blockSize,
+               dev->disk.blockSize);
+        s->next = block + 1;
+        s->run++;
+        dev->perf_tracker.ra_hits++;
+
+        // Começou a consumir este segmento: antecipa o próximo no outro
+        if (block == seg->start) {
+            raRequest(dev, s, seg->start + seg->count);
+        }
+        if (block == seg->start + seg->count - 1) {
+            seg->state = RA_EMPTY;
+        }
+
+        PPOS_PREEMPT_ENABLE;
+        return 1;
+    }
+
+    if (s) {
+        if (block == s->next) {
+            s->run++;
+        } else {
+            // Acesso fora da sequência: recomeça com a janela mínima
+            if (raCancel(s)) {
+                dev->perf_tracker.ra_cancels++;
+            }
+            s->run    = 1;
+            s->window = DISK_RA_MIN;
+        }
+        s->next = block + 1;
+
+        if (s->run >= DISK_RA_TRIGGER &&
+            s->seg[0].state == RA_EMPTY && s->seg[1].state == RA_EMPTY) {
+            raRequest(dev, s, block + 1);
+        }
+    }
+
+    PPOS_PREEMPT_ENABLE;
+    return 0;
+}
+
+/**
+ * Invalida os segmentos antecipados que contêm blocos escritos
+ * 
+ * @param block Primeiro bloco escrito
+ * @param count Número de blocos
+ */
+static void raInvalidate(disk_device_t* dev, int block, int count) {
+    int i, j;
+
+    if (!dev->raEnabled) {
+        return;
+    }
+
+    PPOS_PREEMPT_DISABLE;
+
+    for (i = 0; i < DISK_RA_STREAMS; i++) {
+        for (j = 0; j < 2; j++) {
+            ra_segment_t* seg = &dev->streams[i].seg[j];
+            if (seg->state != RA_EMPTY &&
+                block < seg->start + seg->count && seg->start < block + count) {
+                if (seg->state == RA_PENDING) {
+                    seg->cancelled = 1;
+                } else {
+                    seg->state = RA_EMPTY;
+                }
+            }
+        }
+    }
+
+    PPOS_PREEMPT_ENABLE;
+}
+
+// Há leitura antecipada pedida e o disco está ocioso?
+static int raDue(disk_device_t* dev) {
+    int i, j;
+
+    if (!dev->raEnabled || system_shutdown_requested ||
+        !dev->disk.livre || dev->disk.requestQueue || dev->disk.current) {
+        return 0;
+    }
+    for (i = 0; i < DISK_RA_STREAMS; i++) {
+        for (j = 0; j < 2; j++) {
+            if (dev->streams[i].seg[j].state == RA_WANTED) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * Envia ao disco uma leitura antecipada pedida (executado pelo gerente)
+ * 
+ * Só com o disco ocioso e a fila vazia, para não atrasar as leituras
+ * das tarefas; uma por vez, a mais antiga pedida primeiro na tabela.
+ */
+static void processReadAhead(disk_device_t* dev) {
+    ra_segment_t* seg = NULL;
+    int i, j;
+
+    if (!raDue(dev)) {
+        return;
+    }
+
+    PPOS_PREEMPT_DISABLE;
+    for (i = 0; i < DISK_RA_STREAMS && !seg; i++) {
+        for (j = 0; j < 2 && !seg; j++) {
+            if (dev->streams[i].seg[j].state == RA_WANTED) {
+                seg = &dev->streams[i].seg[j];
+                seg->state = RA_PENDING;
+            }
+        }
+    }
+    PPOS_PREEMPT_ENABLE;
+
+    diskrequest_t* request = createRangeRequest(dev, DISK_CMD_READ, seg->start, seg->count, NULL, 1);
+    if (!request) {
+        PPOS_PREEMPT_DISABLE;
+        seg->state = RA_EMPTY;
+        PPOS_PREEMPT_ENABLE;
+        return;
+    }
+    request->task         = NULL;           // leitura antecipada: sem dona
+    request->buffer       = seg->data;
+    request->one.iov_base = seg->data;
+    request->one.iov_len  = (size_t)seg->count * dev->disk.blockSize;
+    dev->perf_tracker.ra_blocks += seg->count;
+
+    disk_enqueue(request);
+}
+
+/**
+ * Conclusão de uma leitura antecipada (executado pelo gerente)
+ * 
+ * O segmento é descartado se foi invalidado enquanto era lido ou se tem
+ * bloco sujo no cache (o disco ainda tem a versão antiga).
+ * 
+ * @param request Requisição sem dona criada por processReadAhead
+ * @param status 0 em sucesso, ERROR_INVALID se o disco falhou
+ */
+static void raDone(disk_device_t* dev, diskrequest_t* request, int status) {
+    ra_stream_t* s = NULL;
+    ra_segment_t* seg = NULL;
+    int i, j, wake = 0;
+
+    PPOS_PREEMPT_DISABLE;
+
+    for (i = 0; i < DISK_RA_STREAMS && !seg; i++) {
+        for (j = 0; j < 2 && !seg; j++) {
+            if (dev->streams[i].seg[j].data == request->one.iov_base) {
+                s = &dev->streams[i];
+                seg = &s->seg[j];
+            }
+        }
+    }
+
+    if (seg->cancelled || status < 0 || cacheHasDirty(dev, seg->start, seg->count)) {
+        seg->state = RA_EMPTY;
+        seg->cancelled = 0;
+    } else {
+        seg->state = RA_READY;
+    }
+    if (s->waiting) {
+        s->waiting = 0;
+        wake = 1;
+    }
+
+    PPOS_PREEMPT_ENABLE;
+
+    if (wake) {
+        sem_up(&s->ready);
+    }
+    requestFree(request);
+}
+
+
+/**
+ * ============================================================================
+ * POOL DE REQUISIÇÕES
+ * ============================================================================
+ *
+ * As requisições vêm de vagas reservadas na inicialização de cada disco,
+ * numa lista livre de todos os discos: criar e liberar uma requisição não
+ * chama malloc nem free, e o semáforo de cada vaga é criado uma só vez
+ * (volta a zero a cada uso).
+ * Com o pool vazio, uma tarefa espera até uma vaga ser liberada
+ * (contrapressão); o gerente nunca espera, e deixa para depois a
+ * gravação de volta ou a leitura antecipada que não conseguiu vaga.
+ */
+
+/**
+ * Acrescenta vagas ao pool
+ * 
+ * O tamanho das vagas é fixado pelo primeiro disco; um disco com bloco
+ * maior não cabe nelas.
+ * 
+ * @param capacity Número de vagas
+ * @param blockSize Tamanho do bloco, para a cópia da escrita de volta
+ * @return 0 em sucesso, ERROR_INVALID sem memória ou com bloco maior
+ */
+static int requestPoolGrow(int capacity, int blockSize) {
+    size_t stride = (sizeof(diskrequest_t) + blockSize + 15) & ~(size_t)15;
+    int i;
+
+    if (!requestPool.stride) {
+        requestPool.stride = stride;
+        sem_create(&requestPool.freed, 0);
+    }
+    if (stride > requestPool.stride) {
+        return ERROR_INVALID;
+    }
+
+    char* slots = malloc((size_t)capacity * requestPool.stride);
+    if (!slots) {
+        return ERROR_INVALID;
+    }
+
+    PPOS_PREEMPT_DISABLE;
+    for (i = capacity - 1; i >= 0; i--) {
+        diskrequest_t* request = (diskrequest_t*)(slots + (size_t)i * requestPool.stride);
+        sem_create(&request->done, 0);      // Dona espera aqui até a conclusão
+        request->next = requestPool.free;
+        requestPool.free = request;
+    }
+    requestPool.capacity  += capacity;
+    requestPool.available += capacity;
+    requestPool.lowest    += capacity;
+    PPOS_PREEMPT_ENABLE;
+    return 0;
+}
+
+/**
+ * Retira uma vaga do pool
+ * 
+ * Uma tarefa espera enquanto o pool estiver vazio; o gerente recebe NULL.
+ * 
+ * @return Vaga com o semáforo done zerado, ou NULL
+ */
+static diskrequest_t* requestAlloc(void) {
+    diskrequest_t* request;
+
+    PPOS_PREEMPT_DISABLE;
+    while (!(request = requestPool.free) && !isDiskManager(taskExec)) {
+        requestPool.waiters++;
+        requestPool.waits++;
+        PPOS_PREEMPT_ENABLE;
+        sem_down(&requestPool.freed);   // outra pode levar a vaga antes: tenta de novo
+        PPOS_PREEMPT_DISABLE;
+    }
+    if (request) {
+        requestPool.free = request->next;
+        if (--requestPool.available < requestPool.lowest) {
+            requestPool.lowest = requestPool.available;
+        }
+    }
+    PPOS_PREEMPT_ENABLE;
+
+    return request;
+}
+
+/**
+ * Devolve uma vaga ao pool, acordando uma tarefa que espera por ela
+ * 
+ * Se o pool estava vazio, acorda também os gerentes, que podem ter
+ * deixado uma gravação de volta para depois.
+ * 
+ * @param request Requisição concluída (e já coletada, se tinha dona)
+ */
+static void requestFree(diskrequest_t* request) {
+    int wake;
+
+    PPOS_PREEMPT_DISABLE;
+    if (!requestPool.free) {
+        wakeAllManagers();
+    }
+    request->next = requestPool.free;
+    requestPool.free = request;
+    requestPool.available++;
+    wake = requestPool.waiters > 0;
+    if (wake) {
+        requestPool.waiters--;
+    }
+    PPOS_PREEMPT_ENABLE;
+
+    if (wake) {
+        sem_up(&requestPool.freed);
+    }
+}
+
+
+/**
+ * ============================================================================
+ * FUNÇÕES AUXILIARES
+ * ============================================================================
+ */
+
+/**
+ * Cria uma nova requisição de disco
  * 
  * Aloca e inicializa uma estrutura de requisição com os
  * parâmetros fornecidos.
  * 
+ * @param dev Disco da requisição
  * @param operation Tipo de operação (DISK_CMD_READ ou DISK_CMD_WRITE)
  * @param block Número do bloco alvo
  * @param buffer Buffer de dados
  * @return Ponteiro para requisição criada ou NULL em erro
  */
-diskrequest_t* createDiskRequest(int operation, int block, void *buffer) {
+static diskrequest_t* createBlockRequest(disk_device_t* dev, int operation, int block, void *buffer) {
+
+    diskrequest_t* request = createRangeRequest(dev, operation, block, 1, NULL, 1);
+    if (!request) {
+        return NULL;
+    }
+
+    request->buffer = buffer;           // Buffer de dados
+    request->one.iov_base = buffer;     // Mesmo buffer, como iov de um bloco
+    request->one.iov_len  = dev->disk.blockSize;
+
+    return request;
+}
+
+/**
+ * Cria uma requisição para um intervalo de blocos consecutivos
+ * 
+ * @param dev Disco da requisição
+ * @param operation Tipo de operação (DISK_CMD_READ ou DISK_CMD_WRITE)
+ * @param block Primeiro bloco
+ * @param count Número de blocos
+ * @param iov Buffers dos blocos (NULL: usa request->one); um pedaço de um
+ *            intervalo maior começa em request->offset
+ * @param iovcnt Número de buffers em iov
+ * @return Ponteiro para requisição criada ou NULL em erro
+ */
+static diskrequest_t* createRangeRequest(disk_device_t* dev, int operation, int block, int count,
+                                         const struct iovec* iov, int iovcnt) {
 
-    diskrequest_t* request = malloc(sizeof(diskrequest_t));
+    diskrequest_t* request = requestAlloc();    // Espera vaga, se for uma tarefa
     if (!request) {
         return NULL;
     }
@@ -470,25 +3318,103 @@ diskrequest_t* createDiskRequest(int operation, int block, void *buffer) {
     request->next = NULL;               // Inicializa ponteiros da lista
     request->task = taskExec;           // Tarefa solicitante atual
     request->operation = operation;     // Tipo de operação
-    request->block = block;             // Bloco alvo no disco
-    request->buffer = buffer;           // Buffer de dados
+    request->block = block;             // Primeiro bloco no disco
+    request->count = count;             // Blocos consecutivos
+    request->iov = iov ? iov : &request->one;
+    request->iovcnt = iovcnt;
+    request->offset = 0;                // Os blocos começam no início de iov
+    request->buffer = iov ? iov[0].iov_base : NULL;
+    request->merged = NULL;             // Ainda não fundida a outras
+    request->status = 0;                // Resultado, definido na conclusão
+    request->finished = 0;
+    request->flow = NULL;               // Fila da dona, definida ao entrar na fila
+    request->arrival = systime();       // Redefinida ao entrar na fila
+    request->device = dev;              // Fila e gerente que a atendem
 
     return request;
 }
 
 /**
- * Executa uma requisição de disco
+ * Junta à requisição escolhida as da fila com a mesma operação em blocos
+ * vizinhos, formando um intervalo contínuo de até DISK_MERGE_MAX blocos
+ * 
+ * As vizinhas são procuradas no índice: as que começam no fim do
+ * intervalo e as que terminam no seu início (começam até DISK_MERGE_MAX
+ * blocos antes dele). As fundidas saem da fila e são encadeadas em
+ * head->merged. Executado com disk.semaforo_queue obtido.
+ * 
+ * @param head Requisição escolhida pelo escalonador (já fora da fila)
+ */
+static void mergeAdjacent(disk_device_t* dev, diskrequest_t* head) {
+    int start = head->block;
+    int end   = head->block + head->count;
+    diskrequest_t* last = head;
+    diskrequest_t* request;
+
+    do {
+        // Depois do fim do intervalo
+        for (request = indexCeiling(dev, end, 0); request && request->block == end;
+             request = indexNext(dev, request)) {
+            if (request->operation == head->operation &&
+                end - start + request->count <= DISK_MERGE_MAX) {
+                break;
+            }
+        }
+        if (request && request->block != end) {
+            request = NULL;
+        }
+
+        // Antes do início do intervalo
+        if (!request) {
+            for (request = indexCeiling(dev, end - DISK_MERGE_MAX, 0);
+                 request && request->block < start; request = indexNext(dev, request)) {
+                if (request->operation == head->operation &&
+                    request->block + request->count == start &&
+                    end - request->block <= DISK_MERGE_MAX) {
+                    break;
+                }
+            }
+            if (request && request->block >= start) {
+                request = NULL;
+            }
+        }
+
+        if (request) {
+            queueRemove(dev, request);
+            if (request->block == end) {
+                end += request->count;
+            } else {
+                start = request->block;
+            }
+            last->merged = request;
+            last = request;
+            dev->perf_tracker.merged_requests++;
+        }
+    } while (request);
+
+    dev->inflight.start = start;
+    dev->inflight.count = end - start;
+}
+
+/**
+ * Executa uma requisição de disco (com as vizinhas fundidas a ela)
  * 
- * Atualiza métricas, determina comando apropriado e executa
- * a operação no hardware do disco.
+ * O intervalo inteiro é uma só operação: com o disco mapeado em memória,
+ * um só comando (disk_cmd_range) com a latência do intervalo; o
+ * disk-driver.o atende um bloco por comando, então lê ou escreve o
+ * primeiro bloco, com a sua latência, e os demais são transferidos na
+ * conclusão (finishOperation). Uma requisição única cujos blocos estão num
+ * só buffer usa o buffer da dona; as demais passam pelo buffer dos
+ * intervalos fundidos (nenhuma passa de DISK_MERGE_MAX blocos). Se o
+ * disco recusar o comando, as requisições são concluídas com erro e as
+ * donas acordadas de imediato.
  * 
  * @param request Ponteiro para requisição a ser executada
- * @return 0 em sucesso
+ * @return 0 em sucesso, ERROR_INVALID se o disco recusou o comando
  */
-static int executeRequest(diskrequest_t* request) {
-    
-    // Atualiza métricas de movimentação da cabeça
-    updatePerformanceMetrics(perf_tracker.current_head_position, request->block);
+static int executeRequest(disk_device_t* dev, diskrequest_t* request) {
+    diskrequest_t* member;
+    size_t bs = dev->disk.blockSize;
     
     // Determina comando apropriado para o hardware
     int disk_command;
@@ -498,16 +3424,276 @@ static int executeRequest(diskrequest_t* request) {
     else {
         disk_command = DISK_CMD_WRITE;
     }
+
+    // Buffer contínuo do intervalo
+    dev->inflight.bounce = NULL;
+    dev->inflight.data   = request->merged ? NULL
+                         : iovContiguous(request->iov, request->iovcnt, request->offset,
+                                         (size_t)request->count * bs);
+    if (!dev->inflight.data) {
+        if (dev->inflight.count > DISK_MERGE_MAX) {
+            finishOperation(dev, request, ERROR_INVALID);
+            return ERROR_INVALID;
+        }
+        dev->inflight.bounce = dev->inflight.buffer;
+        dev->inflight.data   = dev->inflight.bounce;
+
+        if (disk_command == DISK_CMD_WRITE) {
+            for (member = request; member; member = member->merged) {
+                iovGather(dev->inflight.data + (member->block - dev->inflight.start) * bs,
+                          member->iov, member->iovcnt, member->offset, member->count * bs);
+            }
+        }
+    }
     
+    // Marca o disco ocupado antes do comando: o SIGUSR1 só é repassado aos
+    // gerentes com operação em andamento, e pode chegar dentro do comando
+    dev->disk.livre   = 0;                   // Marca disco como ocupado
+    dev->disk.current = request;             // Operação em andamento
+
     // Executa operação no hardware do disco
-    disk_cmd(disk_command, request->block, request->buffer);
+    if (deviceRange(dev, disk_command, dev->inflight.start, dev->inflight.count,
+                    dev->inflight.data) < 0) {
+        dev->disk.livre   = 1;
+        dev->disk.current = NULL;
+        finishOperation(dev, request, ERROR_INVALID);
+        return ERROR_INVALID;
+    }
     
-    disk.livre = 0;                     // Marca disco como ocupado
-    perf_tracker.requests_processed++;  // Incrementa contador de requisições
+    // Atualiza métricas: a cabeça vai ao início e termina no fim do intervalo
+    updatePerformanceMetrics(dev, dev->perf_tracker.current_head_position, dev->inflight.start);
+    dev->perf_tracker.current_head_position = dev->inflight.start + dev->inflight.count - 1;
+    
+    dev->perf_tracker.disk_operations++;     // Incrementa contador de operações
     
     return 0;
 }
 
+/**
+ * Conclui a operação em andamento e todas as requisições atendidas nela
+ * 
+ * Sem disk_cmd_range, transfere os blocos do intervalo além do primeiro
+ * (que o disk-driver.o já transferiu) direto na imagem, sem latência:
+ * adaptação ao driver original, que não conhece intervalos. Depois
+ * distribui os dados lidos às donas.
+ * 
+ * @param head Requisição executada, com as fundidas em head->merged
+ * @param status 0 em sucesso, ERROR_INVALID se o disco falhou
+ */
+static void finishOperation(disk_device_t* dev, diskrequest_t* head, int status) {
+    diskrequest_t *member, *next;
+    size_t bs   = dev->disk.blockSize;
+    size_t rest = (dev->inflight.count - 1) * bs;
+    off_t where = (off_t)(dev->inflight.start + 1) * bs;
+
+    if (status == 0 && rest > 0 && !dev->inflight.ranged) {
+        ssize_t done = (head->operation == DISK_CMD_READ)
+                     ? pread(dev->diskFile, dev->inflight.data + bs, rest, where)
+                     : pwrite(dev->diskFile, dev->inflight.data + bs, rest, where);
+        if (done != (ssize_t)rest) {
+            status = ERROR_INVALID;
+        }
+    }
+
+    for (member = head; member; member = next) {
+        char* data = dev->inflight.data + (member->block - dev->inflight.start) * bs;
+
+        next = member->merged;      // a dona pode liberar member ao acordar
+        if (dev->inflight.bounce && status == 0 && member->operation == DISK_CMD_READ) {
+            iovScatter(member->iov, member->iovcnt, member->offset, data, member->count * bs);
+        }
+        dev->perf_tracker.requests_processed++;
+        completeRequest(dev, member, status, data);
+    }
+
+    dev->inflight.bounce = NULL;
+}
+
+/**
+ * Conclui uma requisição
+ * 
+ * Em sucesso, os blocos lidos ou escritos entram no cache antes de a dona
+ * acordar, enquanto os dados ainda são válidos; assim o cache segue a
+ * ordem em que o disco concluiu as operações. Requisições sem dona são
+ * leituras antecipadas ou escritas de volta do cache.
+ * 
+ * @param request Requisição concluída
+ * @param status 0 em sucesso, ERROR_INVALID se o disco recusou o comando
+ * @param data Conteúdo contínuo dos blocos da requisição
+ */
+static void completeRequest(disk_device_t* dev, diskrequest_t* request, int status, char* data) {
+    disk_flow_t* flow = request->flow;
+    unsigned int latency = systime() - request->arrival;
+    int k;
+
+    // E/S da tarefa dona (ou do sistema)
+    flow->ops++;
+    flow->bytes += (size_t)request->count * dev->disk.blockSize;
+    flow->wait  += latency;
+    flow->outstanding--;
+
+    if (!request->task) {
+        if (request->operation == DISK_CMD_READ) {
+            raDone(dev, request, status);
+        } else {
+            cacheFlushDone(dev, request, status);
+        }
+        return;
+    }
+
+    if (status == 0) {
+        for (k = 0; k < request->count; k++) {
+            cacheUpdate(dev, request->block + k, data + (size_t)k * dev->disk.blockSize,
+                        request->operation == DISK_CMD_READ);
+        }
+    }
+
+    latencyRecord(dev, latency);
+
+    // Dona já terminou: ninguém vai coletar o descritor assíncrono, e a
+    // fila fica livre na sua última conclusão
+    if (flow->exited) {
+        requestFree(request);
+        if (!flow->outstanding) {
+            flow->exited  = 0;
+            flow->task_id = FLOW_FREE;
+        }
+        return;
+    }
+
+    // Acorda a dona (que libera a requisição ao acordar), e também se ela
+    // espera por qualquer uma das suas
+    request->status   = status;
+    request->finished = 1;
+    sem_up(&request->done);
+    if (flow->anyWake) {
+        disk_flow_t* waiter = flow->anyWake;
+        flow->anyWake = NULL;
+        sem_up(&waiter->anyDone);
+    }
+}
+
+// Faixa do histograma de uma latência
+static int latencyBucket(unsigned int latency) {
+    int e = 31;
+
+    if (latency < LATENCY_EXACT) {
+        return latency;
+    }
+    while (!(latency >> e)) {
+        e--;
+    }
+    return LATENCY_EXACT + (e - 4) * LATENCY_SUB + ((latency >> (e - 3)) & (LATENCY_SUB - 1));
+}
+
+// Maior latência que cai numa faixa do histograma
+static unsigned int latencyBucketTop(int bucket) {
+    if (bucket < LATENCY_EXACT) {
+        return bucket;
+    }
+    int e   = (bucket - LATENCY_EXACT) / LATENCY_SUB + 4;
+    int sub = (bucket - LATENCY_EXACT) % LATENCY_SUB;
+
+    return ((unsigned int)(LATENCY_SUB + sub + 1) << (e - 3)) - 1;
+}
+
+// Conta a latência de uma requisição concluída (executado pelo gerente)
+static void latencyRecord(disk_device_t* dev, unsigned int latency) {
+    dev->stats.latencyHist[latencyBucket(latency)]++;
+    dev->stats.num_latencies++;
+    if (latency > dev->stats.max_latency) {
+        dev->stats.max_latency = latency;
+    }
+}
+
+// Percentil p (0 a 100) das latências, pelo posto mais próximo: o topo da
+// faixa onde ele cai (nunca acima da máxima)
+static unsigned int latencyPercentile(disk_device_t* dev, int p) {
+    unsigned int rank = ((unsigned long long)p * dev->stats.num_latencies + 99) / 100;
+    unsigned int seen = 0;
+    int i;
+
+    for (i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += dev->stats.latencyHist[i];
+        if (seen >= rank && seen > 0) {
+            unsigned int top = latencyBucketTop(i);
+            return (top < dev->stats.max_latency) ? top : dev->stats.max_latency;
+        }
+    }
+    return dev->stats.max_latency;
+}
+
+// Junta em dst os len bytes dos buffers de iov a partir de offset
+static void iovGather(char* dst, const struct iovec* iov, int iovcnt, size_t offset, size_t len) {
+    int i;
+
+    for (i = 0; i < iovcnt && len > 0; i++) {
+        if (offset >= iov[i].iov_len) {
+            offset -= iov[i].iov_len;
+            continue;
+        }
+        size_t n = iov[i].iov_len - offset < len ? iov[i].iov_len - offset : len;
+        memcpy(dst, (char*)iov[i].iov_base + offset, n);
+        dst += n;
+        len -= n;
+        offset = 0;
+    }
+}
+
+// Espalha len bytes de src pelos buffers de iov a partir de offset
+static void iovScatter(const struct iovec* iov, int iovcnt, size_t offset, const char* src, size_t len) {
+    int i;
+
+    for (i = 0; i < iovcnt && len > 0; i++) {
+        if (offset >= iov[i].iov_len) {
+            offset -= iov[i].iov_len;
+            continue;
+        }
+        size_t n = iov[i].iov_len - offset < len ? iov[i].iov_len - offset : len;
+        memcpy((char*)iov[i].iov_base + offset, src, n);
+        src += n;
+        len -= n;
+        offset = 0;
+    }
+}
+
+// Os len bytes de iov a partir de offset, se estão num só buffer; senão NULL
+static char* iovContiguous(const struct iovec* iov, int iovcnt, size_t offset, size_t len) {
+    int i;
+
+    for (i = 0; i < iovcnt && offset >= iov[i].iov_len; i++) {
+        offset -= iov[i].iov_len;
+    }
+    if (i == iovcnt || iov[i].iov_len - offset < len) {
+        return NULL;
+    }
+    return (char*)iov[i].iov_base + offset;
+}
+
+/**
+ * Blocos percorridos pela cabeça de old_pos até new_pos na política ativa
+ * 
+ * O SCAN, ao inverter, vai antes até a borda do disco; o CSCAN, ao voltar
+ * ao início, vai até o último bloco e retorna ao bloco 0, e a volta também
+ * conta. As demais políticas (LOOK e C-LOOK inclusive) vão direto à
+ * requisição.
+ * 
+ * @param old_pos Posição anterior da cabeça
+ * @param new_pos Nova posição da cabeça
+ * @return Distância percorrida em blocos
+ */
+static int headMovement(disk_device_t* dev, int old_pos, int new_pos) {
+    int last = dev->disk.numBlocks - 1;
+
+    if (dev->perf_tracker.turned && dev->perf_tracker.active_policy == SCHEDULER_SCAN) {
+        return (dev->perf_tracker.last_direction < 0) ? (last - old_pos) + (last - new_pos)
+                                                 : old_pos + new_pos;
+    }
+    if (dev->perf_tracker.turned && dev->perf_tracker.active_policy == SCHEDULER_CSCAN) {
+        return (last - old_pos) + last + new_pos;
+    }
+    return abs(new_pos - old_pos);
+}
 
 /**
  * Atualiza métricas de performance do sistema
@@ -518,11 +3704,11 @@ static int executeRequest(diskrequest_t* request) {
  * @param old_pos Posição anterior da cabeça
  * @param new_pos Nova posição da cabeça
  */
-static void updatePerformanceMetrics(int old_pos, int new_pos) {
-    int movement = abs(new_pos - old_pos);          // Calcula movimento
-    perf_tracker.total_head_movements += movement;  // Acumula movimento total
-    perf_tracker.current_head_position = new_pos;   // Atualiza posição atual
-    stats.total_seek_distance += movement;          // Atualiza estatística de seek
+static void updatePerformanceMetrics(disk_device_t* dev, int old_pos, int new_pos) {
+    int movement = headMovement(dev, old_pos, new_pos);  // Calcula movimento
+    dev->perf_tracker.total_head_movements += movement;  // Acumula movimento total
+    dev->perf_tracker.current_head_position = new_pos;   // Atualiza posição atual
+    dev->stats.total_seek_distance += movement;          // Atualiza estatística de seek
 }
 
 /**
@@ -531,33 +3717,218 @@ static void updatePerformanceMetrics(int old_pos, int new_pos) {
  * Exibe relatório de performance incluindo política ativa,
  * operações realizadas e métricas de eficiência.
  */
-static void printSystemStatistics(void) {
-    printf("\n=== RELATÓRIO DE PERFORMANCE DO SISTEMA ===\n");
+static void printSystemStatistics(disk_device_t* dev) {
+    if (dev->id == 0) {
+        printf("\n=== RELATÓRIO DE PERFORMANCE DO SISTEMA ===\n");
+    } else {
+        printf("\n=== RELATÓRIO DE PERFORMANCE DO DISCO %d (%s) ===\n", dev->id, dev->image);
+    }
     
     // Determina nome da política ativa
     char* policy_name;
-    if (perf_tracker.active_policy == SCHEDULER_FCFS) {
+    if (dev->perf_tracker.active_policy == SCHEDULER_FCFS) {
         policy_name = "FCFS";
-    } else if (perf_tracker.active_policy == SCHEDULER_SSTF) {
+    } else if (dev->perf_tracker.active_policy == SCHEDULER_SSTF) {
         policy_name = "SSTF";
+    } else if (dev->perf_tracker.active_policy == SCHEDULER_SCAN) {
+        policy_name = "SCAN";
+    } else if (dev->perf_tracker.active_policy == SCHEDULER_LOOK) {
+        policy_name = "LOOK";
+    } else if (dev->perf_tracker.active_policy == SCHEDULER_CLOOK) {
+        policy_name = "C-LOOK";
+    } else if (dev->perf_tracker.active_policy == SCHEDULER_DEADLINE) {
+        policy_name = "DEADLINE";
+    } else if (dev->perf_tracker.active_policy == SCHEDULER_FAIR) {
+        policy_name = "FAIR";
     } else {
         policy_name = "CSCAN";
     }
     
     printf(" -- Política ativa: %s\n", policy_name);
-    printf(" -- Requisições processadas: %d\n", perf_tracker.requests_processed);
-    printf(" -- Operações de leitura: %u\n", stats.read_operations);
-    printf(" -- Operações de escrita: %u\n", stats.write_operations);
-    printf(" -- Movimentação total da cabeça: %d blocos\n", perf_tracker.total_head_movements);
-    if (perf_tracker.requests_processed > 0) {
+    printf(" -- Requisições processadas: %d\n", dev->perf_tracker.requests_processed);
+    printf(" -- Operações no disco: %d (%d requisições fundidas a vizinhas)\n",
+           dev->perf_tracker.disk_operations, dev->perf_tracker.merged_requests);
+    printf(" -- Operações de leitura: %u\n", dev->stats.read_operations);
+    printf(" -- Operações de escrita: %u\n", dev->stats.write_operations);
+    printf(" -- Movimentação total da cabeça: %d blocos\n", dev->perf_tracker.total_head_movements);
+    if (dev->perf_tracker.requests_processed > 0) {
         printf(" -- Movimentação média por requisição: %.2f blocos\n",
-               (float)perf_tracker.total_head_movements / perf_tracker.requests_processed);
+               (float)dev->perf_tracker.total_head_movements / dev->perf_tracker.requests_processed);
+    }
+    if (dev->cache.capacity > 0) {
+        unsigned int lookups = dev->cache.hits + dev->cache.misses;
+        printf(" -- Cache de blocos: %s, %d blocos\n",
+               dev->cache.policy == DISK_CACHE_ARC ? "ARC" : "LRU", dev->cache.capacity);
+        printf(" -- Acertos no cache: %u de %u leituras (%.1f%%)\n", dev->cache.hits, lookups,
+               lookups ? 100.0 * dev->cache.hits / lookups : 0.0);
+        printf(" -- Faltas no cache: %u, substituições: %u\n", dev->cache.misses, dev->cache.evictions);
+        if (dev->cache.policy == DISK_CACHE_ARC) {
+            printf(" -- Faltas com histórico (ARC): %u, alvo de T1: %d\n",
+                   dev->cache.ghost_hits, dev->cache.target);
+        }
+        if (dev->cache.writeBack) {
+            printf(" -- Write-back: %u escritas no cache, %u blocos gravados de volta\n",
+                   dev->cache.write_hits, dev->cache.writebacks);
+        }
+    }
+    if (dev->raEnabled) {
+        printf(" -- Leitura antecipada: %d blocos lidos, %d leituras atendidas, %d esperas, %d cancelamentos\n",
+               dev->perf_tracker.ra_blocks, dev->perf_tracker.ra_hits, dev->perf_tracker.ra_waits,
+               dev->perf_tracker.ra_cancels);
+    }
+    if (dev->stats.read_operations > 0) {
+        printf(" -- Latência média de leitura: %.1f ms\n",
+               (float)dev->stats.read_time / dev->stats.read_operations);
+    }
+    if (dev->stats.write_operations > 0) {
+        printf(" -- Latência média de escrita: %.1f ms\n",
+               (float)dev->stats.write_time / dev->stats.write_operations);
     }
+    if (dev->stats.num_latencies > 0) {
+        printf(" -- Latência das requisições: p50 %u ms, p99 %u ms, máxima %u ms\n",
+               latencyPercentile(dev, 50), latencyPercentile(dev, 99), dev->stats.max_latency);
+    }
+    if (dev->perf_tracker.active_policy == SCHEDULER_DEADLINE) {
+        printf(" -- Requisições atendidas com prazo vencido: %d\n", dev->perf_tracker.expired_served);
+    }
+    if (dev->perf_tracker.active_policy == SCHEDULER_FAIR) {
+        printf(" -- Fatias concedidas às filas das tarefas: %u\n", dev->fair.slices);
+    }
+    printf(" -- Pool de requisições: %d vagas, até %d em uso, %u esperas por vaga\n",
+           requestPool.capacity, requestPool.capacity - requestPool.lowest, requestPool.waits);
     printf(" -- Tempo total de execução: %u ms\n", systime());
     printf("===========================================\n");
 }
 
 
+/**
+ * Métricas do gerente de um disco
+ *
+ * Num disco em faixas, a soma das dos membros.
+ *
+ * @param id Número do disco
+ * @param metrics Recebe as métricas
+ * @return 0 em sucesso, ERROR_INVALID se o disco não existe
+ */
+int disk_metrics_dev(int id, diskmetrics_t *metrics) {
+    disk_device_t* dev = deviceOf(id);
+    int i, n;
+
+    if (!dev || !metrics) {
+        return ERROR_INVALID;
+    }
+
+    memset(metrics, 0, sizeof(diskmetrics_t));
+    n = (dev->kind == DEVICE_STRIPE) ? dev->numMembers : 1;
+    for (i = 0; i < n; i++) {
+        disk_device_t* member = (dev->kind == DEVICE_STRIPE) ? &devices[dev->members[i]] : dev;
+
+        metrics->requests     += member->perf_tracker.requests_processed;
+        metrics->operations   += member->perf_tracker.disk_operations;
+        metrics->merged       += member->perf_tracker.merged_requests;
+        metrics->headMovement += member->perf_tracker.total_head_movements;
+    }
+    return 0;
+}
+
+
+/**
+ * ============================================================================
+ * TRACE DAS OPERAÇÕES
+ * ============================================================================
+ */
+
+/*
+ * O trace guarda as chamadas a disk_block_read/disk_block_write do disco
+ * 0 como a aplicação as fez (acertos no cache inclusive), para reproduzi-las
+ * com outra política ou outro disco (pingpong-disk-replay). Os registros se
+ * acumulam num buffer e vão ao arquivo quando ele enche, sem preempção no
+ * meio: a gravação não passa pelo gerente.
+ */
+
+// Grava no arquivo os registros em buffer
+static int traceFlush(void) {
+    size_t len = (size_t)trace.count * sizeof(disktrace_record_t);
+
+    trace.count = 0;
+    return (write(trace.fd, trace.buffer, len) == (ssize_t)len) ? 0 : ERROR_INVALID;
+}
+
+// Acrescenta um registro ao trace, se ligado
+static void traceRecord(int operation, int block) {
+    if (trace.fd < 0) {
+        return;
+    }
+
+    PPOS_PREEMPT_DISABLE;
+    disktrace_record_t* record = &trace.buffer[trace.count++];
+    record->time      = systime() - trace.start;
+    record->task      = taskExec ? taskExec->id : -1;
+    record->operation = operation;
+    record->block     = block;
+    if (trace.count == DISK_TRACE_BUFFER) {
+        traceFlush();
+    }
+    PPOS_PREEMPT_ENABLE;
+}
+
+/**
+ * Começa a gravar o trace do disco 0
+ *
+ * @param path Arquivo do trace (criado ou sobrescrito)
+ * @return 0 em sucesso, ERROR_INVALID sem disco, com trace já ligado ou
+ *         se o arquivo não pôde ser criado
+ */
+int disk_trace_start(const char *path) {
+    disktrace_header_t header;
+
+    if (!path || trace.fd >= 0 || devices[0].kind != DEVICE_DISK) {
+        return ERROR_INVALID;
+    }
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return ERROR_INVALID;
+    }
+
+    header.magic     = DISK_TRACE_MAGIC;
+    header.version   = DISK_TRACE_VERSION;
+    header.numBlocks = devices[0].disk.numBlocks;
+    header.blockSize = devices[0].disk.blockSize;
+    if (write(fd, &header, sizeof(header)) != sizeof(header)) {
+        close(fd);
+        return ERROR_INVALID;
+    }
+
+    trace.count = 0;
+    trace.start = systime();
+    trace.fd    = fd;
+    return 0;
+}
+
+/**
+ * Grava os registros pendentes e fecha o trace
+ *
+ * @return 0 em sucesso, ERROR_INVALID sem trace ligado ou se a gravação falhou
+ */
+int disk_trace_stop(void) {
+    int status;
+
+    if (trace.fd < 0) {
+        return ERROR_INVALID;
+    }
+
+    PPOS_PREEMPT_DISABLE;
+    status = traceFlush();
+    if (close(trace.fd) < 0) {
+        status = ERROR_INVALID;
+    }
+    trace.fd = -1;
+    PPOS_PREEMPT_ENABLE;
+    return status;
+}
+
+
 /**
  * ============================================================================
  * HANDLERS DE SINAL E SHUTDOWN
@@ -573,15 +3944,31 @@ static void printSystemStatistics(void) {
  * @param signum Número do sinal recebido (SIGUSR1)
  */
 void diskSignalHandler(int signum) {
-    disk.sinal = 1;  // Sinaliza conclusão de operação
+    int i;
+
+    // O SIGUSR1 é um só para todos os discos: avisa cada gerente com
+    // comando em andamento, que confere o estado do seu disco
+    for (i = 0; i < DISK_MAX_DEVICES; i++) {
+        disk_device_t* dev = &devices[i];
+
+        if (dev->kind == DEVICE_DISK && dev->disk.current) {
+            dev->disk.sinal = 1;     // Sinaliza conclusão de operação
+            wakeDiskManager(dev);    // Acorda o gerente para tratá-la
+        }
+    }
 }
 
 /**
  * Solicita encerramento gracioso do sistema
  * 
- * Define flag para que o gerenciador termine após processar
- * todas as requisições pendentes.
+ * Define flag para que os gerenciadores terminem após processar
+ * todas as requisições pendentes, acordando-os se estiverem ociosos.
+ * Fecha o trace, se ligado.
  */
 void disk_mgr_shutdown(void) {
+    if (trace.fd >= 0) {
+        disk_trace_stop();
+    }
     system_shutdown_requested = 1;
+    wakeAllManagers();
 }
\ No newline at end of file